@@ -0,0 +1,114 @@
+#include "cachedstorage.h"
+
+#include <string.h>
+
+CachedStorage::CachedStorage(Storage& p_storage) :
+    m_storage(p_storage),
+    m_entries(),
+    m_next(0),
+    m_hits(0),
+    m_misses(0) {
+    invalidate();
+}
+
+void CachedStorage::invalidate() {
+    for (auto& entry : m_entries) {
+        entry.m_name = nullptr;
+    }
+}
+
+CachedStorage::Entry* CachedStorage::find(const char* p_name) {
+    for (auto& entry : m_entries) {
+        if (entry.m_name != nullptr && (entry.m_name == p_name || strcmp(entry.m_name, p_name) == 0)) {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+CachedStorage::Entry& CachedStorage::lookup(const char* p_name) {
+    Entry* entry = find(p_name);
+
+    if (entry != nullptr) {
+        m_hits++;
+        return *entry;
+    }
+
+    m_misses++;
+    entry = &m_entries[m_next];
+    m_next = (m_next + 1) % CACHED_STORAGE_FILES;
+    entry->m_name = p_name;
+    entry->m_exists = m_storage.exists(p_name);
+    entry->m_size = entry->m_exists ? m_storage.size(p_name) : 0;
+    return *entry;
+}
+
+bool CachedStorage::exists(const char* p_name) {
+    return lookup(p_name).m_exists;
+}
+
+size_t CachedStorage::size(const char* p_name) {
+    return lookup(p_name).m_size;
+}
+
+size_t CachedStorage::read(const char* p_name, size_t p_offset, uint8_t* p_buffer, size_t p_length) {
+    Entry& entry = lookup(p_name);
+
+    if (!entry.m_exists || p_offset >= entry.m_size) {
+        return 0;
+    }
+
+    return m_storage.read(p_name, p_offset, p_buffer, p_length);
+}
+
+size_t CachedStorage::write(const char* p_name, const uint8_t* p_buffer, size_t p_length) {
+    Entry& entry = lookup(p_name);
+    size_t written = m_storage.write(p_name, p_buffer, p_length);
+    entry.m_exists = true;
+    entry.m_size = written;
+
+    if (written != p_length) {
+        // State on the file system is unknown
+        entry.m_name = nullptr;
+    }
+
+    return written;
+}
+
+size_t CachedStorage::append(const char* p_name, const uint8_t* p_buffer, size_t p_length) {
+    Entry& entry = lookup(p_name);
+    size_t written = m_storage.append(p_name, p_buffer, p_length);
+    entry.m_exists = true;
+    entry.m_size += written;
+
+    if (written != p_length) {
+        entry.m_name = nullptr;
+    }
+
+    return written;
+}
+
+bool CachedStorage::remove(const char* p_name) {
+    Entry& entry = lookup(p_name);
+
+    if (!entry.m_exists) {
+        return false;
+    }
+
+    bool removed = m_storage.remove(p_name);
+
+    if (removed) {
+        entry.m_exists = false;
+        entry.m_size = 0;
+    } else {
+        // State on the file system is unknown
+        entry.m_name = nullptr;
+    }
+
+    return removed;
+}
+
+void CachedStorage::flush() {
+    m_storage.flush();
+}
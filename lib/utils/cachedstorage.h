@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <storage.h>
+
+// Number of files CachedStorage keeps the metadata of
+#ifndef CACHED_STORAGE_FILES
+#define CACHED_STORAGE_FILES 4
+#endif
+
+/**
+ * Keeps exists(..) and size(..) of the last used files so they do not need a walk of the file system
+ * All writes must go through CachedStorage so the cache stays correct
+ * Names are not copied, they must stay valid as long as the CachedStorage is used
+ */
+class CachedStorage : public Storage {
+private:
+    struct Entry {
+        const char* m_name;
+        bool m_exists;
+        size_t m_size;
+    };
+
+    Storage& m_storage;
+    Entry m_entries[CACHED_STORAGE_FILES];
+    // Entry that is replaced next
+    uint8_t m_next;
+    uint32_t m_hits;
+    uint32_t m_misses;
+
+public:
+    explicit CachedStorage(Storage& p_storage);
+
+    virtual bool exists(const char* p_name);
+    virtual size_t size(const char* p_name);
+    virtual size_t read(const char* p_name, size_t p_offset, uint8_t* p_buffer, size_t p_length);
+    virtual size_t write(const char* p_name, const uint8_t* p_buffer, size_t p_length);
+    virtual size_t append(const char* p_name, const uint8_t* p_buffer, size_t p_length);
+    virtual bool remove(const char* p_name);
+    virtual void flush();
+
+    /**
+     * Forget all metadata, for example after files were changed without CachedStorage
+     */
+    void invalidate();
+
+    uint32_t hits() const {
+        return m_hits;
+    }
+
+    uint32_t misses() const {
+        return m_misses;
+    }
+
+private:
+    Entry* find(const char* p_name);
+    Entry& lookup(const char* p_name);
+};
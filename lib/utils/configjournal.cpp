@@ -0,0 +1,416 @@
+#include "configjournal.h"
+
+#include <string.h>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <propertybinary.h>
+#include <crceeprom.h>
+
+static void writeUint16(uint8_t* p_buffer, uint16_t p_value) {
+    p_buffer[0] = p_value & 0xff;
+    p_buffer[1] = p_value >> 8;
+}
+
+static uint16_t readUint16(const uint8_t* p_buffer) {
+    return p_buffer[0] | (p_buffer[1] << 8);
+}
+
+static void writeUint32(uint8_t* p_buffer, uint32_t p_value) {
+    writeUint16(p_buffer, p_value & 0xffff);
+    writeUint16(p_buffer + 2, p_value >> 16);
+}
+
+static uint32_t readUint32(const uint8_t* p_buffer) {
+    return readUint16(p_buffer) | ((uint32_t)readUint16(p_buffer + 2) << 16);
+}
+
+/**
+ * CRC over the generation and the binary header that follows the slot header
+ * The binary header holds the CRC of the records, so the generation can be trusted without reading the records
+ */
+static uint16_t slotCrc16(const uint8_t* p_header) {
+    uint16_t crc = 0;
+
+    for (size_t i = 4; i < 8; i++) {
+        crc = CRCEEProm::crc16Update(crc, p_header[i]);
+    }
+
+    for (size_t i = CONFIG_SLOT_HEADER_SIZE; i < CONFIG_SLOT_HEADER_SIZE + PROPERTIES_BINARY_HEADER_SIZE; i++) {
+        crc = CRCEEProm::crc16Update(crc, p_header[i]);
+    }
+
+    return crc;
+}
+
+ConfigJournal::ConfigJournal(Storage& p_storage, const char* p_slotAName, const char* p_slotBName, const char* p_journalName, size_t p_compactSize) :
+    m_storage(p_storage),
+    m_slotNames{p_slotAName, p_slotBName},
+    m_journalName(p_journalName),
+    m_compactSize(p_compactSize),
+    m_persisted(),
+    m_activeSlot(0),
+    m_generation(0),
+    m_journalSize(0),
+    m_mustCompact(false),
+    m_staging(),
+    m_stagingOffset(0),
+    m_staged(),
+    m_stage(IDLE),
+    m_saveOk(true),
+    m_costPerByte(0),
+    m_bytesWritten(0),
+    m_bytesChanged(0),
+    m_saves(0),
+    m_compactions(0) {
+}
+
+bool ConfigJournal::load(Properties& p_properties) {
+    m_persisted = Properties();
+    m_activeSlot = 0;
+    m_generation = 0;
+    m_journalSize = 0;
+    m_mustCompact = false;
+    m_stage = IDLE;
+    m_staging.clear();
+
+    uint32_t generations[2];
+    bool valid[2] = {readSlotHeader(0, generations[0]), readSlotHeader(1, generations[1])};
+    // Newest first, the oldest is only parsed when the newest is torn
+    uint8_t order[2] = {0, 1};
+
+    if (valid[1] && (!valid[0] || generations[1] > generations[0])) {
+        order[0] = 1;
+        order[1] = 0;
+    }
+
+    bool loaded = false;
+
+    for (uint8_t i = 0; i < 2 && !loaded; i++) {
+        uint8_t slot = order[i];
+
+        if (valid[slot] && loadSlot(slot)) {
+            m_activeSlot = slot;
+            m_generation = generations[slot];
+            loaded = true;
+        }
+    }
+
+    replayJournal();
+
+    m_persisted.forEach([&p_properties](const char* p_name, const PropertyValue & p_value) {
+        p_properties.put(p_name, p_value);
+    });
+    return loaded || m_persisted.size() > 0;
+}
+
+bool ConfigJournal::readSlotHeader(uint8_t p_slot, uint32_t& p_generation) {
+    uint8_t header[CONFIG_SLOT_HEADER_SIZE + PROPERTIES_BINARY_HEADER_SIZE];
+
+    if (m_storage.read(m_slotNames[p_slot], 0, header, sizeof(header)) != sizeof(header) ||
+        header[0] != 'P' || header[1] != 'S' || header[2] != CONFIG_SLOT_VERSION || header[3] != 0) {
+        return false;
+    }
+
+    if (slotCrc16(header) != readUint16(header + 8)) {
+        return false;
+    }
+
+    p_generation = readUint32(header + 4);
+    return true;
+}
+
+bool ConfigJournal::loadSlot(uint8_t p_slot) {
+    size_t size = m_storage.size(m_slotNames[p_slot]);
+
+    if (size <= CONFIG_SLOT_HEADER_SIZE) {
+        return false;
+    }
+
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[size]);
+    Properties properties;
+
+    if (m_storage.read(m_slotNames[p_slot], 0, buffer.get(), size) != size ||
+        !deserializePropertiesBinary(buffer.get() + CONFIG_SLOT_HEADER_SIZE, size - CONFIG_SLOT_HEADER_SIZE, properties)) {
+        return false;
+    }
+
+    m_persisted = std::move(properties);
+    return true;
+}
+
+bool ConfigJournal::validFrame(const uint8_t* p_records, size_t p_length) {
+    for (size_t position = 0; position < p_length;) {
+        size_t consumed = deserializePropertyRecord(p_records + position, p_length - position, nullptr);
+
+        if (consumed == 0) {
+            return false;
+        }
+
+        position += consumed;
+    }
+
+    return p_length > 0;
+}
+
+void ConfigJournal::replayJournal() {
+    size_t size = m_storage.size(m_journalName);
+
+    if (size < CONFIG_JOURNAL_HEADER_SIZE) {
+        return;
+    }
+
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[size]);
+
+    if (m_storage.read(m_journalName, 0, buffer.get(), size) != size) {
+        return;
+    }
+
+    const uint8_t* header = buffer.get();
+
+    // Journal of an other slot, left behind by an interrupted compaction
+    if (header[0] != 'P' || header[1] != 'J' || header[2] != CONFIG_JOURNAL_VERSION || header[3] != 0 ||
+        readUint32(header + 4) != m_generation) {
+        return;
+    }
+
+    size_t offset = CONFIG_JOURNAL_HEADER_SIZE;
+
+    while (size - offset >= 4) {
+        uint16_t length = readUint16(buffer.get() + offset);
+        const uint8_t* records = buffer.get() + offset + 2;
+
+        if (size - offset - 4 < length ||
+            propertiesCrc16(records, length) != readUint16(records + length) ||
+            !validFrame(records, length)) {
+            break;
+        }
+
+        for (size_t position = 0; position < length;) {
+            position += deserializePropertyRecord(records + position, length - position, &m_persisted);
+        }
+
+        offset += length + 4;
+    }
+
+    m_journalSize = offset;
+    // A torn record at the end cannot be appended to
+    m_mustCompact = m_mustCompact || offset != size;
+}
+
+bool ConfigJournal::save(const Properties& p_properties) {
+    finishSave();
+
+    if (!beginSave(p_properties)) {
+        return false;
+    }
+
+    return finishSave();
+}
+
+bool ConfigJournal::finishSave() {
+    while (!saveStep(SIZE_MAX)) {
+    }
+
+    return m_saveOk;
+}
+
+bool ConfigJournal::beginSave(const Properties& p_properties) {
+    if (m_stage != IDLE) {
+        return false;
+    }
+
+    std::vector<uint8_t> frame;
+    size_t changed = 0;
+
+    if (m_journalSize == 0) {
+        frame.resize(CONFIG_JOURNAL_HEADER_SIZE);
+        frame[0] = 'P';
+        frame[1] = 'J';
+        frame[2] = CONFIG_JOURNAL_VERSION;
+        frame[3] = 0;
+        writeUint32(&frame[4], m_generation);
+    }
+
+    // All changes of one save go in a single frame so they are replayed all or nothing
+    size_t start = frame.size();
+    frame.resize(start + 2);
+    p_properties.forEach([&](const char* p_name, const PropertyValue & p_value) {
+        if (m_persisted.contains(p_name) && m_persisted.get(p_name) == p_value) {
+            return;
+        }
+
+        size_t length = propertyRecordSize(p_name, p_value);
+        size_t offset = frame.size();
+        frame.resize(offset + length);
+        serializePropertyRecord(&frame[offset], p_name, p_value);
+        changed += length;
+    });
+    frame.resize(frame.size() + 2);
+
+    // Erased properties cannot be journaled
+    m_persisted.forEach([&](const char* p_name, const PropertyValue&) {
+        m_mustCompact = m_mustCompact || !p_properties.contains(p_name);
+    });
+
+    m_bytesChanged += changed;
+    m_saveOk = true;
+    m_costPerByte = 0;
+
+    if (m_mustCompact || changed > 0xffff) {
+        return beginCompact(p_properties);
+    }
+
+    if (changed == 0) {
+        return true;
+    }
+
+    writeUint16(&frame[start], changed);
+    writeUint16(&frame[start + 2 + changed], propertiesCrc16(&frame[start + 2], changed));
+
+    m_staging = std::move(frame);
+    m_stagingOffset = 0;
+    m_staged = p_properties;
+    m_stage = JOURNAL;
+    return true;
+}
+
+bool ConfigJournal::compact(const Properties& p_properties) {
+    finishSave();
+    m_saveOk = true;
+
+    if (!beginCompact(p_properties)) {
+        return false;
+    }
+
+    return finishSave();
+}
+
+bool ConfigJournal::beginCompact(const Properties& p_properties) {
+    size_t size = CONFIG_SLOT_HEADER_SIZE + propertiesBinarySize(p_properties);
+    std::vector<uint8_t> buffer(size);
+    uint8_t* header = buffer.data();
+
+    if (serializePropertiesBinary(header + CONFIG_SLOT_HEADER_SIZE, size - CONFIG_SLOT_HEADER_SIZE, p_properties) == 0) {
+        m_saveOk = false;
+        return false;
+    }
+
+    header[0] = 'P';
+    header[1] = 'S';
+    header[2] = CONFIG_SLOT_VERSION;
+    header[3] = 0;
+    writeUint32(header + 4, m_generation + 1);
+    writeUint16(header + 8, slotCrc16(header));
+
+    m_staging = std::move(buffer);
+    m_stagingOffset = 0;
+    m_staged = p_properties;
+    m_stage = SLOT;
+    return true;
+}
+
+bool ConfigJournal::saveStep(size_t p_maxBytes) {
+    if (m_stage == IDLE) {
+        return true;
+    }
+
+    size_t length = std::min(p_maxBytes, m_staging.size() - m_stagingOffset);
+    const uint8_t* data = m_staging.data() + m_stagingOffset;
+    // Never overwrite the active slot, it stays valid until the new slot is complete
+    const char* name = m_stage == SLOT ? m_slotNames[m_activeSlot ^ 1] : m_journalName;
+    // The first chunk of a new file truncates whatever was left behind
+    bool create = m_stagingOffset == 0 && (m_stage == SLOT || m_journalSize == 0);
+    size_t written = create ? m_storage.write(name, data, length) : m_storage.append(name, data, length);
+    m_bytesWritten += written;
+    m_stagingOffset += written;
+
+    if (written != length) {
+        m_storage.flush();
+        // A torn journal frame cannot be appended to, a torn slot is never loaded as long as the journal is intact
+        m_mustCompact = m_mustCompact || m_stage == JOURNAL;
+        m_saveOk = false;
+        m_stage = IDLE;
+        m_staging.clear();
+        return true;
+    }
+
+    if (m_stagingOffset < m_staging.size()) {
+        return false;
+    }
+
+    m_storage.flush();
+    m_saves++;
+    m_staging.clear();
+
+    if (m_stage == JOURNAL) {
+        m_stage = IDLE;
+        m_journalSize += m_stagingOffset;
+        m_persisted = m_staged;
+
+        if (m_journalSize > m_compactSize) {
+            return !beginCompact(m_staged);
+        }
+
+        return true;
+    }
+
+    // The journal is stale from here on because it refers to the previous generation
+    m_storage.remove(m_journalName);
+
+    m_stage = IDLE;
+    m_activeSlot ^= 1;
+    m_generation++;
+    m_persisted = m_staged;
+    m_journalSize = 0;
+    m_mustCompact = false;
+    m_compactions++;
+    return true;
+}
+
+bool ConfigJournal::saveStep(uint32_t p_budget, const std::function<uint32_t()>& p_micros) {
+    uint32_t start = p_micros();
+    bool first = true;
+
+    while (m_stage != IDLE) {
+        uint32_t elapsed = p_micros() - start;
+        size_t remaining = m_staging.size() - m_stagingOffset;
+        size_t chunk = CONFIG_JOURNAL_MIN_CHUNK;
+
+        // Also while there is no cost estimate yet, a chunk can take less than a tick of p_micros
+        if (!first && elapsed >= p_budget) {
+            break;
+        }
+
+        if (m_costPerByte != 0) {
+            // Largest chunk that fits in the budget that is left, according to the slowest chunk seen so far
+            chunk = elapsed >= p_budget ? 0 : ((uint64_t)(p_budget - elapsed) << 8) / m_costPerByte;
+        }
+
+        // At least one chunk per call so the save always progresses
+        if (chunk < CONFIG_JOURNAL_MIN_CHUNK) {
+            if (!first) {
+                break;
+            }
+
+            chunk = CONFIG_JOURNAL_MIN_CHUNK;
+        }
+
+        first = false;
+        chunk = std::min(chunk, remaining);
+        uint32_t chunkStart = p_micros();
+        saveStep(chunk);
+        uint32_t cost = p_micros() - chunkStart;
+        // Cost per byte in 1/256 us, rounded up so the estimate never gets optimistic
+        uint32_t costPerByte = (((uint64_t)cost << 8) + chunk - 1) / chunk;
+        m_costPerByte = std::max(m_costPerByte, costPerByte);
+    }
+
+    if (m_stage == IDLE) {
+        return true;
+    }
+
+    // The chunks of this step are committed together, a finished save was already flushed by saveStep(size_t)
+    m_storage.flush();
+    return false;
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <functional>
+#include <propertyutils.h>
+#include <storage.h>
+
+#define CONFIG_JOURNAL_VERSION 1
+#define CONFIG_JOURNAL_HEADER_SIZE 8
+#define CONFIG_SLOT_VERSION 1
+#define CONFIG_SLOT_HEADER_SIZE 10
+// Smallest chunk written by the time budgeted saveStep(..)
+#ifndef CONFIG_JOURNAL_MIN_CHUNK
+#define CONFIG_JOURNAL_MIN_CHUNK 16
+#endif
+
+/**
+ * Append only journal of configuration changes on top of two snapshot slots
+ *
+ * save(..) only appends the properties that changed since the last save, the latest record of a key wins.
+ * When the journal grows over p_compactSize a fresh snapshot is written to the inactive slot with the next
+ * generation number and the journal is removed. The active slot is never written, so after a power cut
+ * there is always one valid snapshot left. load(..) reads the header of both slots and only parses the
+ * newest valid one, the other slot is only parsed when the newest turns out to be torn.
+ *
+ * The journal header holds the generation of the slot it belongs to, a journal left behind
+ * by a power cut during compaction is therefore ignored. All records of one save go in a single frame
+ * protected by a CRC, a torn frame at the end stops the replay and the next save will then compact.
+ *
+ * A save can be spread over several frames of the main loop: beginSave(..) serializes the changes into a
+ * staging buffer and each saveStep(..) writes the next chunk. A power cut between chunks is handled the
+ * same way as a torn write.
+ *
+ * Slot header, followed by the binary format of propertybinary.h
+ *   'P' 'S'         magic
+ *   uint8_t         version
+ *   uint8_t         reserved, 0
+ *   uint32_t        generation
+ *   uint16_t        CRC of the generation and the binary header
+ * Journal header
+ *   'P' 'J'         magic
+ *   uint8_t         version
+ *   uint8_t         reserved, 0
+ *   uint32_t        generation of the slot
+ * Frame
+ *   uint16_t        length of the records
+ *   records         same as the records in the binary format
+ *   uint16_t        CRC of the records
+ */
+class ConfigJournal {
+private:
+    Storage& m_storage;
+    const char* m_slotNames[2];
+    const char* m_journalName;
+    const size_t m_compactSize;
+    // Properties as they are persisted
+    Properties m_persisted;
+    // Slot that holds the current snapshot, the other slot is written on compaction
+    uint8_t m_activeSlot;
+    uint32_t m_generation;
+    // 0 when the journal must be created
+    size_t m_journalSize;
+    bool m_mustCompact;
+
+    enum Stage : uint8_t {
+        IDLE,
+        // Appending a frame to the journal
+        JOURNAL,
+        // Writing a snapshot to the inactive slot
+        SLOT
+    };
+    // Data of the save in progress, m_stagingOffset bytes are written
+    std::vector<uint8_t> m_staging;
+    size_t m_stagingOffset;
+    // Properties that are persisted once the save in progress completes
+    Properties m_staged;
+    Stage m_stage;
+    bool m_saveOk;
+    // Slowest write seen during this save in 1/256 us per byte, 0 when not yet measured
+    uint32_t m_costPerByte;
+
+    uint32_t m_bytesWritten;
+    uint32_t m_bytesChanged;
+    uint32_t m_saves;
+    uint32_t m_compactions;
+
+public:
+    ConfigJournal(Storage& p_storage, const char* p_slotAName, const char* p_slotBName, const char* p_journalName, size_t p_compactSize);
+
+    /**
+     * Load the newest valid slot and replay the journal into p_properties
+     * Returns false when no valid slot or journal record was found
+     */
+    bool load(Properties& p_properties);
+
+    /**
+     * Append all properties that changed since the last load or save
+     * Compacts when the journal grows over the threshold or when a property was erased
+     * Blocks until everything is written, a save in progress is finished first
+     */
+    bool save(const Properties& p_properties);
+
+    /**
+     * Write a fresh snapshot to the inactive slot and remove the journal, blocks until it´s written
+     */
+    bool compact(const Properties& p_properties);
+
+    /**
+     * Stage the changes of p_properties, nothing is written until saveStep(..) is called
+     * Returns false when a save is still in progress
+     */
+    bool beginSave(const Properties& p_properties);
+
+    /**
+     * Write at most p_maxBytes of the save in progress, the storage is flushed when the save ends
+     * Returns true when the save completed or failed, see lastSaveOk()
+     */
+    bool saveStep(size_t p_maxBytes);
+
+    /**
+     * Write chunks until the save completes or the next chunk would exceed p_budget us
+     * Chunks are sized with the slowest write speed seen during this save, at least one
+     * chunk of CONFIG_JOURNAL_MIN_CHUNK bytes is written per call so the save always progresses.
+     * The storage is flushed once per call, not per chunk
+     */
+    bool saveStep(uint32_t p_budget, const std::function<uint32_t()>& p_micros);
+
+    /**
+     * Write the rest of the save in progress and return lastSaveOk()
+     */
+    bool finishSave();
+
+    bool isSaving() const {
+        return m_stage != IDLE;
+    }
+
+    bool lastSaveOk() const {
+        return m_saveOk;
+    }
+
+    /**
+     * Bytes written to storage including headers, CRC´s and snapshots
+     */
+    uint32_t bytesWritten() const {
+        return m_bytesWritten;
+    }
+
+    /**
+     * Size of the records that actually changed
+     */
+    uint32_t bytesChanged() const {
+        return m_bytesChanged;
+    }
+
+    /**
+     * bytesWritten / bytesChanged
+     */
+    float writeAmplification() const {
+        return m_bytesChanged == 0 ? 0.0f : (float)m_bytesWritten / m_bytesChanged;
+    }
+
+    uint32_t saves() const {
+        return m_saves;
+    }
+
+    uint32_t compactions() const {
+        return m_compactions;
+    }
+
+    size_t journalSize() const {
+        return m_journalSize;
+    }
+
+    /**
+     * Generation of the active slot, 0 when no slot was loaded or written
+     */
+    uint32_t generation() const {
+        return m_generation;
+    }
+
+    uint8_t activeSlot() const {
+        return m_activeSlot;
+    }
+
+private:
+    bool readSlotHeader(uint8_t p_slot, uint32_t& p_generation);
+    bool loadSlot(uint8_t p_slot);
+    void replayJournal();
+    bool beginCompact(const Properties& p_properties);
+    static bool validFrame(const uint8_t* p_records, size_t p_length);
+};
@@ -0,0 +1,173 @@
+#include "controllersettings.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void copyString(char* p_dest, size_t p_size, const Properties& p_properties, const PropertyKey& p_key) {
+    const char* value = "";
+
+    if (p_properties.contains(p_key)) {
+        value = p_properties.get(p_key);
+    }
+
+    strncpy(p_dest, value, p_size - 1);
+    p_dest[p_size - 1] = 0;
+}
+
+void loadControllerSettings(ControllerSettings& p_settings, const Properties& p_properties) {
+    p_settings.ringerOn = p_properties.get(KEY_RINGER_ON).asBool();
+    p_settings.maxRingTime = p_properties.get(KEY_MAX_RING_TIME).asLong();
+    p_settings.frameCatchUp = p_properties.get(KEY_FRAME_CATCH_UP).asLong();
+    p_settings.ringOnTime = p_properties.get(KEY_RING_ON_TIME).asLong();
+    p_settings.ringOffTime = p_properties.get(KEY_RING_OFF_TIME).asLong();
+    p_settings.debounceMinAlpha = p_properties.get(KEY_DEBOUNCE_MIN_ALPHA).asLong();
+    p_settings.debounceMaxAlpha = p_properties.get(KEY_DEBOUNCE_MAX_ALPHA).asLong();
+    p_settings.debounceMinTime = p_properties.get(KEY_DEBOUNCE_MIN_TIME).asLong();
+    p_settings.debounceMaxTime = p_properties.get(KEY_DEBOUNCE_MAX_TIME).asLong();
+    p_settings.mqttPort = p_properties.get(KEY_MQTT_PORT).asLong();
+
+    copyString(p_settings.mqttServer, sizeof(p_settings.mqttServer), p_properties, KEY_MQTT_SERVER);
+    copyString(p_settings.mqttUsername, sizeof(p_settings.mqttUsername), p_properties, KEY_MQTT_USERNAME);
+    copyString(p_settings.mqttPassword, sizeof(p_settings.mqttPassword), p_properties, KEY_MQTT_PASSWORD);
+    copyString(p_settings.mqttClientID, sizeof(p_settings.mqttClientID), p_properties, KEY_MQTT_CLIENT_ID);
+    copyString(p_settings.mqttBaseTopic, sizeof(p_settings.mqttBaseTopic), p_properties, KEY_MQTT_BASE_TOPIC);
+    p_settings.hasMqttServer = p_settings.mqttServer[0] != 0;
+
+    snprintf(p_settings.mqttStatusTopic, sizeof(p_settings.mqttStatusTopic), "%s/%s", p_settings.mqttBaseTopic, MQTT_STATUS);
+    snprintf(p_settings.mqttLastWillTopic, sizeof(p_settings.mqttLastWillTopic), "%s/%s", p_settings.mqttClientID,
+             MQTT_LASTWILL_TOPIC);
+    snprintf(p_settings.mqttSubscriberTopic, sizeof(p_settings.mqttSubscriberTopic), "%s/+", p_settings.mqttClientID);
+}
+
+bool applyConfigDefaults(Properties& p_properties, const char* p_deviceDefault) {
+    bool added = false;
+
+    for (const ConfigSchemaEntry& entry : CONFIG_SCHEMA) {
+        if (p_properties.contains(entry.key)) {
+            continue;
+        }
+
+        switch (entry.type) {
+            case PropertyValue::STRING:
+                p_properties.put(entry.key, PropertyValue(entry.defaultString != nullptr ? entry.defaultString : p_deviceDefault));
+                break;
+
+            case PropertyValue::BOOL:
+                p_properties.put(entry.key, PropertyValue(entry.defaultLong != 0));
+                break;
+
+            default:
+                p_properties.put(entry.key, PropertyValue(entry.defaultLong));
+                break;
+        }
+
+        added = true;
+    }
+
+    return added;
+}
+
+const ConfigSchemaEntry* findConfigSchema(const PropertyKey& p_key) {
+    for (const ConfigSchemaEntry& entry : CONFIG_SCHEMA) {
+        if (entry.key.hash() == p_key.hash() && strcmp(entry.key.name(), p_key.name()) == 0) {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+const ConfigSchemaEntry* findConfigSchema(const char* p_name) {
+    return findConfigSchema(PropertyKey(p_name));
+}
+
+ConfigError validateConfigValue(const ConfigSchemaEntry& p_entry, const PropertyValue& p_value) {
+    if (p_value.type() != p_entry.type) {
+        return ConfigError::WRONG_TYPE;
+    }
+
+    long value;
+
+    switch (p_entry.type) {
+        case PropertyValue::STRING:
+            value = strlen(p_value);
+            break;
+
+        case PropertyValue::LONG:
+            value = p_value.asLong();
+            break;
+
+        default:
+            return ConfigError::NONE;
+    }
+
+    return value < p_entry.min || value > p_entry.max ? ConfigError::OUT_OF_RANGE : ConfigError::NONE;
+}
+
+ConfigError putConfigValue(Properties& p_properties, const PropertyKey& p_key, const PropertyValue& p_value) {
+    const ConfigSchemaEntry* entry = findConfigSchema(p_key);
+
+    if (entry == nullptr) {
+        return ConfigError::UNKNOWN_KEY;
+    }
+
+    ConfigError error = validateConfigValue(*entry, p_value);
+
+    if (error == ConfigError::NONE) {
+        p_properties.put(p_key, p_value);
+    }
+
+    return error;
+}
+
+uint8_t configGroups(const char* p_name) {
+    const ConfigSchemaEntry* entry = findConfigSchema(p_name);
+    return entry == nullptr ? (uint8_t)CONFIG_PERSIST : entry->groups;
+}
+
+void persistentConfig(Properties& p_dest, const Properties& p_properties) {
+    p_properties.forEach([&p_dest](const char* p_name, const PropertyValue & p_value) {
+        if (configGroups(p_name) & CONFIG_PERSIST) {
+            p_dest.put(p_name, p_value);
+        }
+    });
+}
+
+void ConfigListeners::onKey(const PropertyKey& p_key, std::function<void(const PropertyValue&)> p_callback) {
+    m_keyListeners.push_back(KeyListener{p_key, p_callback, false});
+}
+
+void ConfigListeners::onGroup(uint8_t p_groups, std::function<void()> p_callback) {
+    m_groupListeners.push_back(GroupListener{p_groups, p_callback});
+}
+
+uint8_t ConfigListeners::dispatch(Properties& p_properties) {
+    if (!p_properties.isDirty()) {
+        return 0;
+    }
+
+    uint8_t groups = p_properties.isErased() ? CONFIG_PERSIST : 0;
+    p_properties.forEachDirty([&groups](const char* p_name, const PropertyValue&) {
+        groups |= configGroups(p_name);
+    });
+
+    for (auto& listener : m_keyListeners) {
+        listener.m_pending = p_properties.isDirty(listener.m_key);
+    }
+
+    p_properties.clearDirty();
+
+    for (auto& listener : m_keyListeners) {
+        if (listener.m_pending) {
+            listener.m_callback(p_properties.get(listener.m_key));
+        }
+    }
+
+    for (auto& listener : m_groupListeners) {
+        if (listener.m_groups & groups) {
+            listener.m_callback();
+        }
+    }
+
+    return groups;
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <functional>
+#include <propertyutils.h>
+
+// Names of the properties in the controller configuration, hashed at compile time
+constexpr PropertyKey KEY_MQTT_CLIENT_ID{"mqttClientID"};
+constexpr PropertyKey KEY_MQTT_BASE_TOPIC{"mqttBaseTopic"};
+constexpr PropertyKey KEY_MQTT_LAST_WILL_TOPIC{"mqttLastWillTopic"};
+constexpr PropertyKey KEY_MQTT_SERVER{"mqttServer"};
+constexpr PropertyKey KEY_MQTT_USERNAME{"mqttUsername"};
+constexpr PropertyKey KEY_MQTT_PASSWORD{"mqttPassword"};
+constexpr PropertyKey KEY_MQTT_PORT{"mqttPort"};
+constexpr PropertyKey KEY_RINGER_ON{"ringerOn"};
+constexpr PropertyKey KEY_MAX_RING_TIME{"maxRingTime"};
+constexpr PropertyKey KEY_FRAME_CATCH_UP{"frameCatchUp"};
+constexpr PropertyKey KEY_RING_ON_TIME{"ringOnTime"};
+constexpr PropertyKey KEY_RING_OFF_TIME{"ringOffTime"};
+constexpr PropertyKey KEY_DEBOUNCE_MIN_ALPHA{"debounceMin"};
+constexpr PropertyKey KEY_DEBOUNCE_MAX_ALPHA{"debounceMax"};
+constexpr PropertyKey KEY_DEBOUNCE_MIN_TIME{"debounceMinTime"};
+constexpr PropertyKey KEY_DEBOUNCE_MAX_TIME{"debounceMaxTime"};
+
+// Last part of the derived topics <mqttBaseTopic>/status and <mqttClientID>/lastwill
+constexpr char MQTT_STATUS[] = "status";
+constexpr char MQTT_LASTWILL_TOPIC[] = "lastwill";
+
+/**
+ * Plain snapshot of the controller configuration
+ * Rebuild it with loadControllerSettings each time the Properties are modified
+ * so the frame loop and the MQTT code can read plain fields without any lookup or conversion
+ */
+struct ControllerSettings {
+    bool ringerOn;
+    uint32_t maxRingTime;
+    // Cadence of the ringer in ms, rings continuously when either is 0
+    uint16_t ringOnTime;
+    uint16_t ringOffTime;
+    // FrameClock::CatchUp of the frame loop
+    uint8_t frameCatchUp;
+    // Bounds of the alpha filter value of the button, the filter adapts to line noise in between
+    int16_t debounceMinAlpha;
+    int16_t debounceMaxAlpha;
+    // Bounds of the debounce time in us of the captured button edges, it adapts to line noise in between
+    uint32_t debounceMinTime;
+    uint32_t debounceMaxTime;
+    uint16_t mqttPort;
+    bool hasMqttServer;
+    char mqttServer[64];
+    char mqttUsername[32];
+    char mqttPassword[32];
+    char mqttClientID[24];
+    char mqttBaseTopic[24];
+    // Derived topics, <mqttBaseTopic>/status, <mqttClientID>/lastwill and <mqttClientID>/+
+    char mqttStatusTopic[48];
+    char mqttLastWillTopic[48];
+    char mqttSubscriberTopic[32];
+};
+
+/**
+ * What needs to happen when a configuration property changes, a property can be in multiple groups
+ */
+enum ConfigGroup : uint8_t {
+    // Store in flash
+    CONFIG_PERSIST = 1,
+    // Publish the status to MQTT
+    CONFIG_PUBLISH = 2,
+    // Reconnect to the MQTT server
+    CONFIG_RECONNECT = 4,
+    // Persist without waiting for the quiet window of PersistScheduler
+    CONFIG_CRITICAL = 8
+};
+
+/**
+ * Description of a single configuration property
+ * min and max limit the value of LONG properties and the length of STRING properties
+ * A STRING without default gets the device specific default passed to applyConfigDefaults
+ */
+struct ConfigSchemaEntry {
+    PropertyKey key;
+    PropertyValue::Type type;
+    int32_t defaultLong;
+    const char* defaultString;
+    int32_t min;
+    int32_t max;
+    // ConfigGroup flags, derived values are not in CONFIG_PERSIST and are rebuild at boot
+    uint8_t groups;
+};
+
+constexpr ConfigSchemaEntry CONFIG_SCHEMA[] = {
+    {KEY_MQTT_CLIENT_ID, PropertyValue::STRING, 0, nullptr, 1, sizeof(ControllerSettings::mqttClientID) - 1, CONFIG_PERSIST | CONFIG_RECONNECT | CONFIG_CRITICAL},
+    {KEY_MQTT_BASE_TOPIC, PropertyValue::STRING, 0, "DOORBELL", 1, sizeof(ControllerSettings::mqttBaseTopic) - 1, CONFIG_PERSIST | CONFIG_RECONNECT | CONFIG_CRITICAL},
+    {KEY_MQTT_LAST_WILL_TOPIC, PropertyValue::STRING, 0, "DOORBELL/lastwill", 0, sizeof(ControllerSettings::mqttLastWillTopic) - 1, CONFIG_RECONNECT},
+    {KEY_MQTT_SERVER, PropertyValue::STRING, 0, "", 0, sizeof(ControllerSettings::mqttServer) - 1, CONFIG_PERSIST | CONFIG_RECONNECT | CONFIG_CRITICAL},
+    {KEY_MQTT_USERNAME, PropertyValue::STRING, 0, "", 0, sizeof(ControllerSettings::mqttUsername) - 1, CONFIG_PERSIST | CONFIG_RECONNECT | CONFIG_CRITICAL},
+    {KEY_MQTT_PASSWORD, PropertyValue::STRING, 0, "", 0, sizeof(ControllerSettings::mqttPassword) - 1, CONFIG_PERSIST | CONFIG_RECONNECT | CONFIG_CRITICAL},
+    {KEY_MQTT_PORT, PropertyValue::LONG, 1883, nullptr, 1, 65535, CONFIG_PERSIST | CONFIG_RECONNECT | CONFIG_CRITICAL},
+    {KEY_RINGER_ON, PropertyValue::BOOL, true, nullptr, 0, 1, CONFIG_PERSIST | CONFIG_PUBLISH},
+    {KEY_MAX_RING_TIME, PropertyValue::LONG, 5000, nullptr, 0, 60000, CONFIG_PERSIST},
+    {KEY_FRAME_CATCH_UP, PropertyValue::LONG, 1, nullptr, 0, 2, CONFIG_PERSIST},
+    {KEY_RING_ON_TIME, PropertyValue::LONG, 0, nullptr, 0, 10000, CONFIG_PERSIST},
+    {KEY_RING_OFF_TIME, PropertyValue::LONG, 0, nullptr, 0, 10000, CONFIG_PERSIST},
+    {KEY_DEBOUNCE_MIN_ALPHA, PropertyValue::LONG, 110, nullptr, 100, 1000, CONFIG_PERSIST},
+    {KEY_DEBOUNCE_MAX_ALPHA, PropertyValue::LONG, 300, nullptr, 100, 1000, CONFIG_PERSIST},
+    {KEY_DEBOUNCE_MIN_TIME, PropertyValue::LONG, 5000, nullptr, 1000, 100000, CONFIG_PERSIST},
+    {KEY_DEBOUNCE_MAX_TIME, PropertyValue::LONG, 30000, nullptr, 1000, 100000, CONFIG_PERSIST}
+};
+
+enum class ConfigError : uint8_t {
+    NONE,
+    UNKNOWN_KEY,
+    WRONG_TYPE,
+    OUT_OF_RANGE
+};
+
+/**
+ * Put the default of each schema entry that is missing in a single pass over CONFIG_SCHEMA
+ * Returns true when any property was added
+ */
+bool applyConfigDefaults(Properties& p_properties, const char* p_deviceDefault);
+
+/**
+ * Schema entry of a key, nullptr when the key is not in the schema
+ */
+const ConfigSchemaEntry* findConfigSchema(const PropertyKey& p_key);
+const ConfigSchemaEntry* findConfigSchema(const char* p_name);
+
+ConfigError validateConfigValue(const ConfigSchemaEntry& p_entry, const PropertyValue& p_value);
+
+/**
+ * Validate p_value against the schema and put it only when it is valid
+ * Use this for all values that come from MQTT or the portal
+ */
+ConfigError putConfigValue(Properties& p_properties, const PropertyKey& p_key, const PropertyValue& p_value);
+
+/**
+ * ConfigGroup flags of a key, keys that are not in the schema are only persisted
+ */
+uint8_t configGroups(const char* p_name);
+
+/**
+ * Copy all properties that must be persisted, keys that are not in the schema are persisted as well
+ */
+void persistentConfig(Properties& p_dest, const Properties& p_properties);
+
+/**
+ * Listeners for changes of configuration keys or groups, called from dispatch(..) in the main loop
+ * so a burst of changes results in a single call per listener
+ */
+class ConfigListeners {
+private:
+    struct KeyListener {
+        PropertyKey m_key;
+        std::function<void(const PropertyValue&)> m_callback;
+        bool m_pending;
+    };
+    struct GroupListener {
+        uint8_t m_groups;
+        std::function<void()> m_callback;
+    };
+    std::vector<KeyListener> m_keyListeners;
+    std::vector<GroupListener> m_groupListeners;
+
+public:
+    void onKey(const PropertyKey& p_key, std::function<void(const PropertyValue&)> p_callback);
+    /**
+     * p_callback is called once when a key in any of p_groups changed
+     */
+    void onGroup(uint8_t p_groups, std::function<void()> p_callback);
+
+    /**
+     * Call the listeners of all dirty keys and clear the dirty flags of p_properties
+     * Listeners are called after the flags are cleared so they may modify p_properties
+     * Returns the groups that changed, an erased key counts as CONFIG_PERSIST
+     */
+    uint8_t dispatch(Properties& p_properties);
+};
+
+/**
+ * Copy all values from properties into the settings snapshot
+ * Strings that do not fit are truncated, missing values become 0 or empty
+ */
+void loadControllerSettings(ControllerSettings& p_settings, const Properties& p_properties);
@@ -1,5 +1,30 @@
 #pragma once
 
+#include <stdint.h>
+
+// Number of press events a DigitalInput keeps until they are read
+#ifndef DIGITAL_INPUT_EVENTS
+#define DIGITAL_INPUT_EVENTS 8
+#endif
+
+/**
+ * Something that happened to a button, times are in ms of millis()
+ */
+struct PressEvent {
+    enum Type : uint8_t {
+        EDGE_UP, EDGE_DOWN, SINGLE, DOUBLE, LONG
+    };
+    Type m_type;
+    // Increments for each event, a gap means events where lost
+    uint16_t m_sequence;
+    // Start of the press, for a double click the start of the first press
+    uint32_t m_start;
+    // Time the button was pressed, 0 for an edge up
+    // For a double click from the start of the first until the end of the second press
+    // For a long press the time it was held when detected
+    uint32_t m_duration;
+};
+
 class DigitalInput {
 public:
     virtual bool current() const = 0;
@@ -8,4 +33,9 @@ public:
     virtual bool isLong() const = 0;
     virtual bool isEdgeUp() const = 0;
     virtual bool isEdgeDown() const = 0;
+    /**
+     * Move up to p_max of the oldest events into p_events
+     * Returns the number of events moved
+     */
+    virtual uint8_t events(PressEvent* p_events, uint8_t p_max) const = 0;
 };
@@ -2,6 +2,7 @@
 
 #include "digitalknob.h"
 #include <stdint.h>
+#include <math.h>
 #include <algorithm>
 
 #ifndef UNIT_TEST
@@ -22,9 +23,24 @@ extern "C" uint32_t digitalRead(uint8_t);
 #define DIGITAL_KNOB_IS_EDGE_UP 4
 #define DIGITAL_KNOB_IS_EDGE_DOWN 5
 
-//Hysteresis to detect low/high states for debounce
+//Hysteresis to detect low/high states for debounce, can be tuned by replaying traces in libtest
+#ifndef DIGITAL_KNOB_HIGH
 #define DIGITAL_KNOB_HIGH 175
+#endif
+#ifndef DIGITAL_KNOB_LOW
 #define DIGITAL_KNOB_LOW 125
+#endif
+
+// Period in ms over which the noise is measured to adapt alpha, and presses shorter than this many ms are noise
+#ifndef DIGITAL_KNOB_ADAPT_PERIOD
+#define DIGITAL_KNOB_ADAPT_PERIOD 10000
+#endif
+#ifndef DIGITAL_KNOB_SHORT_PRESS
+#define DIGITAL_KNOB_SHORT_PRESS 60
+#endif
+
+// Tick period in ms the alpha filter value and the 32 bit masks are defined for
+#define DIGITAL_KNOB_REFERENCE_PERIOD 20
 
 // Bitmasks for detething the type of press based on the type of press 32 or 64 bit
 #define DIGITAL_KNOB_SINGLE_CLICK_AMASK 0b00000111111111111000000000000000
@@ -35,17 +51,85 @@ extern "C" uint32_t digitalRead(uint8_t);
 #define DIGITAL_KNOB_LONG_PRESS_AMASK   0b11111111111111111111111111111111
 #define DIGITAL_KNOB_LONG_PRESS_TMASK   0b00000001111111111111111111111111
 
+/**
+ * Each bit of a 20ms mask becomes two bits of 10ms
+ */
+static constexpr uint64_t expandMask(uint32_t p_mask, uint8_t p_bit = 0) {
+    return p_bit == 32 ? 0 : ((uint64_t)((p_mask >> p_bit) & 1) * (3ULL << (2 * p_bit))) | expandMask(p_mask, p_bit + 1);
+}
+
+struct DigitalKnobMasks {
+    uint64_t m_singleA;
+    uint64_t m_singleT;
+    uint64_t m_doubleA;
+    uint64_t m_doubleT;
+    uint64_t m_longA;
+    uint64_t m_longT;
+};
+
+static constexpr DigitalKnobMasks DIGITAL_KNOB_MASKS[] = {
+    {
+        DIGITAL_KNOB_SINGLE_CLICK_AMASK, DIGITAL_KNOB_SINGLE_CLICK_TMASK,
+        DIGITAL_KNOB_DOUBLE_CLICK_AMASK, DIGITAL_KNOB_DOUBLE_CLICK_TMASK,
+        DIGITAL_KNOB_LONG_PRESS_AMASK, DIGITAL_KNOB_LONG_PRESS_TMASK
+    },
+    {
+        expandMask(DIGITAL_KNOB_SINGLE_CLICK_AMASK), expandMask(DIGITAL_KNOB_SINGLE_CLICK_TMASK),
+        expandMask(DIGITAL_KNOB_DOUBLE_CLICK_AMASK), expandMask(DIGITAL_KNOB_DOUBLE_CLICK_TMASK),
+        expandMask(DIGITAL_KNOB_LONG_PRESS_AMASK), expandMask(DIGITAL_KNOB_LONG_PRESS_TMASK)
+    }
+};
+
+/**
+ * Coefficient of the low pass filter in 1/2^24 for a tick of p_tickPeriod ms
+ * p_alpha gives 100 / p_alpha per 20ms tick, other tick periods get the coefficient with the same time constant
+ */
+static int32_t filterCoefficient(int16_t p_alpha, uint16_t p_tickPeriod) {
+    double reference = std::min(1.0, 100.0 / p_alpha);
+    double coefficient = 1.0 - pow(1.0 - reference, (double)p_tickPeriod / DIGITAL_KNOB_REFERENCE_PERIOD);
+    return (int32_t)ceil(coefficient * (1L << 24));
+}
+
 DigitalKnob::DigitalKnob(uint8_t p_pin) : DigitalKnob(p_pin, true, 150) {
 }
 
 DigitalKnob::DigitalKnob(uint8_t p_pin, bool p_invert, int16_t p_alpha) :
+    DigitalKnob(p_pin, p_invert, p_alpha, DIGITAL_KNOB_REFERENCE_PERIOD, false) {
+}
+
+DigitalKnob::DigitalKnob(uint8_t p_pin, bool p_invert, int16_t p_alpha, uint16_t p_tickPeriod, bool p_history64) :
     DigitalInput(),
     m_pin(p_pin),
     m_invert(p_invert),
     m_alpha(p_alpha),
+    m_tickPeriod(p_tickPeriod),
+    m_coefficient(filterCoefficient(p_alpha, p_tickPeriod)),
+    m_minAlpha(p_alpha),
+    m_maxAlpha(p_alpha),
     m_rawValue(0x00),
     m_value({}),
-m_status({0x00}) {
+    m_status(0x00),
+    m_history64(p_history64),
+    m_elapsed(0),
+    m_events(),
+    m_eventHead(0),
+    m_eventCount(0),
+    m_sequence(0),
+    m_lostEvents(0),
+    m_pressStart(0),
+    m_previousPressStart(0),
+    m_releaseTime(0),
+    m_longEvent(false),
+    m_edgeUp(false),
+    m_edgeDown(false),
+    m_pressedInPeriod(false),
+    m_deviating(false),
+    m_glitches(0),
+    m_shortPresses(0),
+    m_transitions(0),
+    m_periodGlitches(0),
+    m_periodShortPresses(0),
+    m_periodElapsed(0) {
 }
 
 void DigitalKnob::init() {
@@ -53,60 +137,191 @@ void DigitalKnob::init() {
 }
 
 void DigitalKnob::handle() {
-    // Debounce input
+    handle((bool)digitalRead(m_pin));
+}
 
-    bool pin = digitalRead(m_pin);
-    /*if (millis() % 5000 < 2500) {
-        pin = false;
-    } else {
-        pin = true;
-    }*/
+void DigitalKnob::handle(bool p_pin) {
+    // Debounce input
 
-    int16_t correction = ((pin ^ m_invert ? 0xff : 0) - m_rawValue) * 100;
-    m_rawValue = m_rawValue + correction / m_alpha;
-    m_rawValue = std::max((int16_t)0, std::min(m_rawValue, (int16_t)0xff));
+    int32_t correction = ((p_pin ^ m_invert ? 0xff << 8 : 0) - m_rawValue);
+    m_rawValue = m_rawValue + (int32_t)((int64_t)correction * m_coefficient / (1L << 24));
+    m_rawValue = std::max((int32_t)0, std::min(m_rawValue, (int32_t)0xff << 8));
 
-    bool previousButtonState = m_value[DIGITAL_KNOB_CURRENT];
+    bool current = m_value[DIGITAL_KNOB_CURRENT];
 
     // Hysteresis for digital input
-    if (m_rawValue > DIGITAL_KNOB_HIGH) {
-        m_value[DIGITAL_KNOB_CURRENT] = true;
-    } else if (m_rawValue < DIGITAL_KNOB_LOW) {
-        m_value[DIGITAL_KNOB_CURRENT] = false;
+    if (m_rawValue > DIGITAL_KNOB_HIGH << 8) {
+        current = true;
+    } else if (m_rawValue < DIGITAL_KNOB_LOW << 8) {
+        current = false;
+    }
+
+    // A sample that differs from the debounced state is a glitch when it returns before the state changes
+    if (current != m_value[DIGITAL_KNOB_CURRENT]) {
+        m_deviating = false;
+    } else if ((p_pin ^ m_invert) != current) {
+        m_deviating = true;
+    } else if (m_deviating) {
+        m_deviating = false;
+        m_glitches++;
+        m_periodGlitches++;
+    }
+
+    handleDebounced(current);
+
+    if (m_minAlpha != m_maxAlpha && (m_periodElapsed += m_tickPeriod) >= DIGITAL_KNOB_ADAPT_PERIOD) {
+        adapt();
+    }
+}
+
+void DigitalKnob::adaptiveAlpha(int16_t p_minAlpha, int16_t p_maxAlpha) {
+    m_minAlpha = p_minAlpha;
+    m_maxAlpha = std::max(p_minAlpha, p_maxAlpha);
+    m_periodGlitches = 0;
+    m_periodShortPresses = 0;
+    m_periodElapsed = 0;
+    int16_t alpha = std::max(m_minAlpha, std::min(m_alpha, m_maxAlpha));
+
+    if (alpha != m_alpha) {
+        m_alpha = alpha;
+        m_coefficient = filterCoefficient(m_alpha, m_tickPeriod);
+    }
+}
+
+void DigitalKnob::adapt() {
+    int32_t alpha = m_alpha;
+
+    // Up fast when noise passed the filter, down slowly on a clean line
+    if (m_periodShortPresses > 0) {
+        alpha = alpha + alpha / 4 + 1;
+    } else if (m_periodGlitches == 0) {
+        alpha = alpha - alpha / 8;
     }
 
-    // Shift and insert current bit into register
-    m_status.m_status32 = m_status.m_status32 << 1;
-    m_status.m_status8[0] = m_status.m_status8[0] | m_value[DIGITAL_KNOB_CURRENT];
+    alpha = std::max((int32_t)m_minAlpha, std::min(alpha, (int32_t)m_maxAlpha));
 
-    // Reset buttons if they where not captured for a duration
-    if (m_status.m_status32 == 0x00) {
-        resetButtons();
+    if (alpha != m_alpha) {
+        m_alpha = alpha;
+        m_coefficient = filterCoefficient(m_alpha, m_tickPeriod);
     }
 
-    // Detect up/down edges
-    m_value[DIGITAL_KNOB_IS_EDGE_UP] = (m_value[DIGITAL_KNOB_CURRENT] && !previousButtonState);
-    m_value[DIGITAL_KNOB_IS_EDGE_DOWN] = (previousButtonState && !m_value[DIGITAL_KNOB_CURRENT]);
+    m_periodGlitches = 0;
+    m_periodShortPresses = 0;
+    m_periodElapsed = 0;
+}
+
+void DigitalKnob::handleDebounced(bool p_current) {
+    handleDebounced(p_current, millis());
+}
+
+void DigitalKnob::handleDebounced(bool p_current, uint32_t p_edgeTime) {
+    // Edge events first, a click detected in this tick needs the time of this edge
+    handleChange(p_current, p_edgeTime);
+    handleTick();
+}
 
-    // detect long press
-    if ((m_status.m_status32 | DIGITAL_KNOB_LONG_PRESS_AMASK) == DIGITAL_KNOB_LONG_PRESS_AMASK &&
-        (m_status.m_status32 & DIGITAL_KNOB_LONG_PRESS_TMASK) == DIGITAL_KNOB_LONG_PRESS_TMASK) {
-        m_value[DIGITAL_KNOB_IS_LONG_PRESS] = true;
+void DigitalKnob::handleChange(bool p_current, uint32_t p_edgeTime) {
+    if (p_current == m_value[DIGITAL_KNOB_CURRENT]) {
+        return;
     }
 
-    // Detect single click
-    if ((m_status.m_status32 | DIGITAL_KNOB_SINGLE_CLICK_AMASK) == DIGITAL_KNOB_SINGLE_CLICK_AMASK &&
-        (m_status.m_status32 & DIGITAL_KNOB_SINGLE_CLICK_TMASK) == DIGITAL_KNOB_SINGLE_CLICK_TMASK) {
-        m_value[DIGITAL_KNOB_IS_SINGLE_CLICK] = true;
-        m_status.m_status32 = 0x00;
+    m_value[DIGITAL_KNOB_CURRENT] = p_current;
+    m_transitions++;
+
+    if (p_current) {
+        m_previousPressStart = m_pressStart;
+        m_pressStart = p_edgeTime;
+        m_longEvent = false;
+        m_edgeUp = true;
+        m_pressedInPeriod = true;
+        pushEvent(PressEvent::EDGE_UP, p_edgeTime, 0);
+    } else {
+        m_releaseTime = p_edgeTime;
+        m_edgeDown = true;
+
+        if (p_edgeTime - m_pressStart < DIGITAL_KNOB_SHORT_PRESS) {
+            m_shortPresses++;
+            m_periodShortPresses++;
+        }
+
+        pushEvent(PressEvent::EDGE_DOWN, m_pressStart, p_edgeTime - m_pressStart);
     }
+}
+
+void DigitalKnob::handleTick() {
+    const uint32_t now = millis();
+    const uint8_t historyPeriod = m_history64 ? DIGITAL_KNOB_REFERENCE_PERIOD / 2 : DIGITAL_KNOB_REFERENCE_PERIOD;
+    const DigitalKnobMasks& masks = DIGITAL_KNOB_MASKS[m_history64];
+    const uint64_t window = m_history64 ? UINT64_MAX : UINT32_MAX;
+
+    for (m_elapsed += m_tickPeriod; m_elapsed >= historyPeriod; m_elapsed -= historyPeriod) {
+        // Shift and insert current bit into register, a press that ended within the period counts as well
+        m_status = ((m_status << 1) | m_value[DIGITAL_KNOB_CURRENT] | m_pressedInPeriod) & window;
+        m_pressedInPeriod = false;
 
-    // Detect double click
-    if ((m_status.m_status32 | DIGITAL_KNOB_DOUBLE_CLICK_AMASK) == DIGITAL_KNOB_DOUBLE_CLICK_AMASK &&
-        (m_status.m_status32 & DIGITAL_KNOB_DOUBLE_CLICK_TMASK) == DIGITAL_KNOB_DOUBLE_CLICK_TMASK) {
-        m_value[DIGITAL_KNOB_IS_DOUBLE_CLICK] = true;
-        m_status.m_status32 = 0x00;
+        // Reset buttons if they where not captured for a duration
+        if (m_status == 0x00) {
+            resetButtons();
+        }
+
+        // detect long press
+        if ((m_status | masks.m_longA) == masks.m_longA &&
+            (m_status & masks.m_longT) == masks.m_longT) {
+            m_value[DIGITAL_KNOB_IS_LONG_PRESS] = true;
+
+            if (!m_longEvent) {
+                pushEvent(PressEvent::LONG, m_pressStart, now - m_pressStart);
+                m_longEvent = true;
+            }
+        }
+
+        // Detect single click
+        if ((m_status | masks.m_singleA) == masks.m_singleA &&
+            (m_status & masks.m_singleT) == masks.m_singleT) {
+            m_value[DIGITAL_KNOB_IS_SINGLE_CLICK] = true;
+            m_status = 0x00;
+            pushEvent(PressEvent::SINGLE, m_pressStart, m_releaseTime - m_pressStart);
+        }
+
+        // Detect double click
+        if ((m_status | masks.m_doubleA) == masks.m_doubleA &&
+            (m_status & masks.m_doubleT) == masks.m_doubleT) {
+            m_value[DIGITAL_KNOB_IS_DOUBLE_CLICK] = true;
+            m_status = 0x00;
+            pushEvent(PressEvent::DOUBLE, m_previousPressStart, m_releaseTime - m_previousPressStart);
+        }
+    }
+
+    // Detect up/down edges, every tick so a faster tick rate detects them faster
+    // Both are set when a press started and ended within this tick
+    m_value[DIGITAL_KNOB_IS_EDGE_UP] = m_edgeUp;
+    m_value[DIGITAL_KNOB_IS_EDGE_DOWN] = m_edgeDown;
+    m_edgeUp = false;
+    m_edgeDown = false;
+}
+
+void DigitalKnob::pushEvent(PressEvent::Type p_type, uint32_t p_start, uint32_t p_duration) {
+    // Overwrite the oldest event when full, the sequence numbers show the gap
+    if (m_eventCount == DIGITAL_INPUT_EVENTS) {
+        m_eventHead = (m_eventHead + 1) % DIGITAL_INPUT_EVENTS;
+        m_eventCount--;
+        m_lostEvents++;
     }
+
+    m_events[(m_eventHead + m_eventCount) % DIGITAL_INPUT_EVENTS] = PressEvent{p_type, m_sequence++, p_start, p_duration};
+    m_eventCount++;
+}
+
+uint8_t DigitalKnob::events(PressEvent* p_events, uint8_t p_max) const {
+    uint8_t count = std::min(p_max, m_eventCount);
+
+    for (uint8_t i = 0; i < count; i++) {
+        p_events[i] = m_events[m_eventHead];
+        m_eventHead = (m_eventHead + 1) % DIGITAL_INPUT_EVENTS;
+    }
+
+    m_eventCount -= count;
+    return count;
 }
 
 bool DigitalKnob::current() const {
@@ -147,5 +362,5 @@ void DigitalKnob::resetButtons() const {
 }
 
 void DigitalKnob::reset() const {
-    m_status.m_status32 = 0x00;
+    m_status = 0x00;
 }
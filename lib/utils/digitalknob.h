@@ -13,23 +13,55 @@
  * It will beable to detect single click, double click or long press edgeUp and edgeDown situations
  * It is protected against debounce
  *
- * Ensure you call the handle function 50 times/sec to handle the single/double click timing correctly
+ * Ensure you call the handle function 50 times/sec to handle the single/double click timing correctly,
+ * or pass the tick period to the constructor to call it at any rate up to 1000 times/sec
  *
- * button states are captured and remembered for as long we have bit´s in the train of up to 50 ticks
+ * button states are captured in a history of 32 bits of 20ms, or optionally 64 bits of 10ms, independent of the tick rate
  * After that all states will be reset to 0.
  */
 class DigitalKnob : public DigitalInput {
 private:
-    union BITS32 {
-        uint32_t m_status32;
-        uint8_t m_status8[4];
-    };
     const uint8_t m_pin;
     const bool m_invert;
-    const int16_t m_alpha;
-    int16_t m_rawValue;
+    int16_t m_alpha;
+    // ms between calls to handle
+    const uint16_t m_tickPeriod;
+    // Filter coefficient for m_tickPeriod in 1/2^24
+    int32_t m_coefficient;
+    // Bounds of m_alpha, equal when the filter does not adapt
+    int16_t m_minAlpha;
+    int16_t m_maxAlpha;
+    // Filtered input 0..255 in 1/256
+    int32_t m_rawValue;
     mutable std::bitset<6> m_value;
-    mutable BITS32 m_status;
+    // History of the button, bit 0 is the latest, one bit per 20ms or 10ms with the 64 bit history
+    mutable uint64_t m_status;
+    const bool m_history64;
+    // ms since the last shift of m_status
+    uint16_t m_elapsed;
+    // Ring of events not read yet
+    mutable PressEvent m_events[DIGITAL_INPUT_EVENTS];
+    mutable uint8_t m_eventHead;
+    mutable uint8_t m_eventCount;
+    uint16_t m_sequence;
+    uint32_t m_lostEvents;
+    // ms of the start of the current or last press, the press before that and the last release
+    uint32_t m_pressStart;
+    uint32_t m_previousPressStart;
+    uint32_t m_releaseTime;
+    bool m_longEvent;
+    // Changes since the last tick, a press that started since the last shift of m_status
+    bool m_edgeUp;
+    bool m_edgeDown;
+    bool m_pressedInPeriod;
+    // Noise statistics, totals and the counts of the current adapt period
+    bool m_deviating;
+    uint32_t m_glitches;
+    uint32_t m_shortPresses;
+    uint32_t m_transitions;
+    uint16_t m_periodGlitches;
+    uint16_t m_periodShortPresses;
+    uint16_t m_periodElapsed;
 public:
     /**
      * Build a button with standard coviguration
@@ -44,12 +76,45 @@ public:
      * param: Alpha wilter value default 150, the hihger the value the more filtering on the digital input
      */
     DigitalKnob(uint8_t p_pin, bool p_invert, int16_t p_alpha);
+    /**
+     * Build a button that is handled every p_tickPeriod ms
+     * param: Alpha filter value as if handled 50 times/sec, the filter keeps the same time constant at any tick rate
+     * param: p_history64 keeps 64 bits of 10ms instead of 32 bits of 20ms, same click timing with a finer resolution
+     */
+    DigitalKnob(uint8_t p_pin, bool p_invert, int16_t p_alpha, uint16_t p_tickPeriod, bool p_history64);
 
     /**
-     * Call the handle function 50 times/sec for correct button detection
+     * Call the handle function 50 times/sec, or every tick period passed to the constructor
      */
     void handle();
 
+    /**
+     * Same as handle() with the level of the pin read by the caller, for example with FastPin
+     */
+    void handle(bool p_pin);
+
+    /**
+     * Same as handle() for an input that is already debounced, events are timed with millis()
+     */
+    void handleDebounced(bool p_current);
+
+    /**
+     * Same as handleDebounced(bool) with p_edgeTime the millis() of the last edge of p_current, for example of
+     * EdgeCapture, so press events are not quantized to the tick period
+     */
+    void handleDebounced(bool p_current, uint32_t p_edgeTime);
+
+    /**
+     * Apply one change of an input that is already debounced without advancing the tick, p_edgeTime in ms
+     * Call it for every change in order, then handleTick() once per tick, so presses shorter than a tick are not lost
+     */
+    void handleChange(bool p_current, uint32_t p_edgeTime);
+
+    /**
+     * Advance one tick after the changes of this tick where passed to handleChange(..)
+     */
+    void handleTick();
+
     /**
      * Initialise the button and enable the pin modus
      * It sets the pin mode to INPUT_PULLUP but for the esp8266 that didn´t work,
@@ -86,6 +151,46 @@ public:
      * Resets it´s internal state s a second call to this function will return false
      */
     virtual bool isEdgeDown() const;
+    /**
+     * Let the filter adapt to the noise on the line, alpha stays within p_minAlpha and p_maxAlpha
+     * Every DIGITAL_KNOB_ADAPT_PERIOD ms alpha goes up when presses shorter than DIGITAL_KNOB_SHORT_PRESS passed the
+     * filter and down when there where no glitches at all, so a clean line gets the lowest latency
+     */
+    void adaptiveAlpha(int16_t p_minAlpha, int16_t p_maxAlpha);
+    /**
+     * Current alpha filter value
+     */
+    int16_t alpha() const {
+        return m_alpha;
+    }
+    /**
+     * Samples that differed from the debounced state and returned before the state changed
+     */
+    uint32_t glitches() const {
+        return m_glitches;
+    }
+    /**
+     * Presses shorter than DIGITAL_KNOB_SHORT_PRESS, most likely noise that passed the filter
+     */
+    uint32_t shortPresses() const {
+        return m_shortPresses;
+    }
+    /**
+     * Changes of the debounced state
+     */
+    uint32_t transitions() const {
+        return m_transitions;
+    }
+    /**
+     * Events are kept until read, edges and clicks that happen between two reads are not lost
+     */
+    virtual uint8_t events(PressEvent* p_events, uint8_t p_max) const;
+    /**
+     * Oldest events that where overwritten because the queue was full
+     */
+    uint32_t lostEvents() const {
+        return m_lostEvents;
+    }
     /**
      * Reset the internal state, but not the button states
      */
@@ -97,8 +202,8 @@ public:
     /**
      * Return the internal representation of the system
      */
-    std::bitset<32> intern() const {
-        return std::bitset<32>(m_status.m_status32);
+    std::bitset<64> intern() const {
+        return std::bitset<64>(m_status);
     }
     /**
      * Return the internal representation of the buttom states
@@ -106,4 +211,7 @@ public:
     std::bitset<6> presses() const {
         return std::bitset<6>(m_value);
     }
+private:
+    void adapt();
+    void pushEvent(PressEvent::Type p_type, uint32_t p_start, uint32_t p_duration);
 };
@@ -0,0 +1,81 @@
+#include "digitalknobbank.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#else
+extern "C" uint32_t pinMode(uint8_t, uint8_t);
+extern uint32_t GPIStubbed;
+#define GPI GPIStubbed
+#define INPUT_PULLUP 2
+#endif
+
+static uint32_t pinMask(std::initializer_list<uint8_t> p_pins) {
+    uint32_t mask = 0;
+
+    for (uint8_t pin : p_pins) {
+        mask |= 1UL << pin;
+    }
+
+    return mask;
+}
+
+DigitalKnobBank::DigitalKnobBank(std::initializer_list<uint8_t> p_pins, bool p_invert) :
+    m_pins(p_pins),
+    m_knobs(),
+    m_mask(pinMask(p_pins)),
+    m_invert(p_invert ? m_mask : 0),
+    m_count0(0),
+    m_count1(0),
+    m_state(0),
+    m_edgeUp(0),
+    m_edgeDown(0),
+    m_active(0) {
+    m_knobs.reserve(m_pins.size());
+
+    for (uint8_t pin : m_pins) {
+        m_knobs.emplace_back(pin, p_invert, 100);
+    }
+}
+
+void DigitalKnobBank::init() {
+    for (uint8_t pin : m_pins) {
+        pinMode(pin, INPUT_PULLUP);
+    }
+}
+
+void DigitalKnobBank::handle() {
+    handle(GPI);
+}
+
+void DigitalKnobBank::handle(uint32_t p_inputs) {
+    uint32_t sample = (p_inputs ^ m_invert) & m_mask;
+
+    // Count equal samples that differ from the state, reset the count of lanes that match the state
+    uint32_t delta = sample ^ m_state;
+    m_count1 = (m_count1 ^ m_count0) & delta;
+    m_count0 = ~m_count0 & delta;
+    // Lanes that differed 4 times in a row
+    uint32_t toggle = delta & ~(m_count0 | m_count1);
+    m_state ^= toggle;
+    m_edgeUp = toggle & m_state;
+    m_edgeDown = toggle & ~m_state;
+
+    m_active |= m_state;
+    uint32_t stillActive = m_state;
+
+    for (uint8_t i = 0; i < m_pins.size() && m_active != 0; i++) {
+        uint32_t bit = 1UL << m_pins[i];
+
+        if (m_active & bit) {
+            DigitalKnob& knob = m_knobs[i];
+            knob.handleDebounced(m_state & bit);
+
+            // Idle once the press left the history of the knob
+            if (knob.intern().any()) {
+                stillActive |= bit;
+            }
+        }
+    }
+
+    m_active = stillActive;
+}
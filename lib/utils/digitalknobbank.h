@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <initializer_list>
+#include <digitalknob.h>
+
+/**
+ * Several buttons on GPIO 0..15 debounced together from a single read of the GPIO input register
+ *
+ * Each pin is a bit lane of a 2 bit vertical counter, a pin changes state after 4 equal samples in a row.
+ * Debouncing and edge detection cost the same for 1 or 16 buttons. Click detection runs per button
+ * with the masks of DigitalKnob but only for buttons that are pressed or have a press in their history.
+ *
+ * Call handle() 50 times/sec like DigitalKnob
+ */
+class DigitalKnobBank {
+private:
+    std::vector<uint8_t> m_pins;
+    std::vector<DigitalKnob> m_knobs;
+    const uint32_t m_mask;
+    const uint32_t m_invert;
+    // Vertical counter, bit n of both counters is the counter of GPIO n
+    uint32_t m_count0;
+    uint32_t m_count1;
+    uint32_t m_state;
+    uint32_t m_edgeUp;
+    uint32_t m_edgeDown;
+    // Buttons that still need click detection
+    uint32_t m_active;
+
+public:
+    /**
+     * p_invert for normal pull-up wiring
+     */
+    DigitalKnobBank(std::initializer_list<uint8_t> p_pins, bool p_invert);
+
+    /**
+     * Set the pin mode of all pins
+     */
+    void init();
+
+    /**
+     * Read the GPIO input register and handle all buttons
+     */
+    void handle();
+
+    /**
+     * Handle all buttons with p_inputs as the GPIO input register
+     */
+    void handle(uint32_t p_inputs);
+
+    uint8_t size() const {
+        return m_knobs.size();
+    }
+
+    /**
+     * Single, double and long press of button p_index, in order of the pins passed to the constructor
+     */
+    const DigitalInput& operator[](uint8_t p_index) const {
+        return m_knobs[p_index];
+    }
+
+    /**
+     * Debounced state and edges of all buttons, bit n is GPIO n
+     */
+    uint32_t current() const {
+        return m_state;
+    }
+
+    uint32_t edgeUp() const {
+        return m_edgeUp;
+    }
+
+    uint32_t edgeDown() const {
+        return m_edgeDown;
+    }
+};
@@ -0,0 +1,118 @@
+#include "edgecapture.h"
+#include <algorithm>
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#define EDGE_CAPTURE_IRAM IRAM_ATTR
+#else
+#define EDGE_CAPTURE_IRAM
+#endif
+
+EdgeCapture::EdgeCapture(bool p_level, uint32_t p_debounce) :
+    m_edges(),
+    m_changes(),
+    m_minDebounce(p_debounce),
+    m_maxDebounce(p_debounce),
+    m_raw(p_level),
+    m_rawSince(0),
+    m_inBurst(false),
+    m_burstStart(0),
+    m_periodStart(0),
+    m_periodGlitches(0),
+    m_periodShortPresses(0),
+    m_stable(p_level),
+    m_lastPress(0),
+    m_lastRelease(0),
+    m_edgeCount(0),
+    m_glitches(0),
+    m_shortPresses(0),
+    m_debounce(p_debounce) {
+}
+
+void EdgeCapture::adaptiveDebounce(uint32_t p_min, uint32_t p_max) {
+    // Applied by the next adapt(), update(..) may be running in an interrupt
+    m_minDebounce = p_min;
+    m_maxDebounce = p_max;
+}
+
+void EDGE_CAPTURE_IRAM EdgeCapture::capture(bool p_level, uint32_t p_time) {
+    m_edges.push(Edge{p_time, p_level});
+}
+
+void EDGE_CAPTURE_IRAM EdgeCapture::accept() {
+    m_inBurst = false;
+
+    if (m_raw == m_stable) {
+        m_glitches = m_glitches + 1;
+        m_periodGlitches++;
+        return;
+    }
+
+    m_stable = m_raw;
+    m_changes.push(Edge{m_burstStart, m_stable});
+
+    if (m_stable) {
+        m_lastPress = m_burstStart;
+    } else {
+        m_lastRelease = m_burstStart;
+
+        if (m_lastRelease - m_lastPress < EDGE_CAPTURE_SHORT_PRESS) {
+            m_shortPresses = m_shortPresses + 1;
+            m_periodShortPresses++;
+        }
+    }
+}
+
+void EDGE_CAPTURE_IRAM EdgeCapture::adapt() {
+    uint32_t debounce = m_debounce;
+    uint32_t lower = m_minDebounce;
+    uint32_t upper = std::max(lower, (uint32_t)m_maxDebounce);
+
+    // Up fast when noise passed the debounce time, down slowly on a clean line
+    if (m_periodShortPresses > 0) {
+        debounce = debounce + debounce / 4 + 1;
+    } else if (m_periodGlitches == 0) {
+        debounce = debounce - debounce / 8;
+    }
+
+    m_debounce = std::max(lower, std::min(debounce, upper));
+    m_periodGlitches = 0;
+    m_periodShortPresses = 0;
+}
+
+bool EDGE_CAPTURE_IRAM EdgeCapture::update(uint32_t p_now) {
+    Edge edge;
+
+    while (m_edges.pop(edge)) {
+        // The interrupt reads the level, after a lost edge two edges can have the same level
+        if (edge.m_level == m_raw) {
+            continue;
+        }
+
+        m_edgeCount = m_edgeCount + 1;
+
+        if (m_inBurst && edge.m_time - m_rawSince >= m_debounce) {
+            accept();
+        }
+
+        if (!m_inBurst) {
+            m_inBurst = true;
+            m_burstStart = edge.m_time;
+        }
+
+        m_raw = edge.m_level;
+        m_rawSince = edge.m_time;
+    }
+
+    // Signed, an edge captured after p_now was taken is newer than p_now
+    if (m_inBurst && (int32_t)(p_now - m_rawSince) >= (int32_t)m_debounce) {
+        accept();
+    }
+
+    if (p_now - m_periodStart >= EDGE_CAPTURE_ADAPT_PERIOD) {
+        m_periodStart = p_now;
+        adapt();
+    }
+
+    return m_stable;
+}
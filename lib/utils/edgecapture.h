@@ -0,0 +1,153 @@
+#pragma once
+
+#include <stdint.h>
+#include <spscqueue.h>
+
+// Number of edges that can wait for update(..), a bouncing contact easily gives 10 edges per press
+#ifndef EDGE_CAPTURE_SIZE
+#define EDGE_CAPTURE_SIZE 32
+#endif
+
+// Number of accepted changes that can wait for the loop, a frame holds at most a few presses
+#ifndef EDGE_CAPTURE_CHANGES
+#define EDGE_CAPTURE_CHANGES 8
+#endif
+
+// Period in us after which the debounce time adapts, presses shorter than EDGE_CAPTURE_SHORT_PRESS us are noise
+#define EDGE_CAPTURE_ADAPT_PERIOD 10000000
+#define EDGE_CAPTURE_SHORT_PRESS 60000
+
+/**
+ * Timestamped edges of a digital input captured from the pin change interrupt, debounced by a timer interrupt
+ *
+ * The interrupt calls capture(..) with the level and micros(), update(..) consumes the edges and accepts a level once
+ * it was stable for the debounce time. A press or release is timestamped with the first edge of its bounce so
+ * the time is not quantized to the loop rate. update(..) may run in an other interrupt than capture(..), the
+ * main loop then reads every accepted change with nextChange(..), also when a press was accepted and released
+ * between two frames, and the results like current(), lastPress() and lastRelease().
+ */
+class EdgeCapture {
+public:
+    struct Edge {
+        uint32_t m_time;
+        bool m_level;
+    };
+
+private:
+    SpscQueue<Edge, EDGE_CAPTURE_SIZE> m_edges;
+    // Accepted levels with the time of their first edge, from update(..) to the loop
+    SpscQueue<Edge, EDGE_CAPTURE_CHANGES> m_changes;
+    // Bounds of m_debounce, set by the loop
+    volatile uint32_t m_minDebounce;
+    volatile uint32_t m_maxDebounce;
+
+    // Only accessed from update(..)
+    bool m_raw;
+    uint32_t m_rawSince;
+    bool m_inBurst;
+    uint32_t m_burstStart;
+    uint32_t m_periodStart;
+    uint16_t m_periodGlitches;
+    uint16_t m_periodShortPresses;
+
+    // Written by update(..), read by the loop
+    volatile bool m_stable;
+    volatile uint32_t m_lastPress;
+    volatile uint32_t m_lastRelease;
+    volatile uint32_t m_edgeCount;
+    volatile uint32_t m_glitches;
+    volatile uint32_t m_shortPresses;
+    volatile uint32_t m_debounce;
+
+public:
+    /**
+     * p_level is the level before the first edge, p_debounce in us
+     */
+    EdgeCapture(bool p_level, uint32_t p_debounce);
+
+    /**
+     * Interrupt side, p_level is the level after the edge and p_time micros()
+     */
+    void capture(bool p_level, uint32_t p_time);
+
+    /**
+     * Consume the captured edges, p_now in us
+     * Returns the debounced level
+     */
+    bool update(uint32_t p_now);
+
+    bool current() const {
+        return m_stable;
+    }
+
+    /**
+     * Time in us of the first edge of the last accepted press and release
+     */
+    uint32_t lastPress() const {
+        return m_lastPress;
+    }
+
+    uint32_t lastRelease() const {
+        return m_lastRelease;
+    }
+
+    /**
+     * Number of consumed edges
+     */
+    uint32_t edges() const {
+        return m_edgeCount;
+    }
+
+    /**
+     * Bursts of edges that ended at the level they started from, noise or contact bounce
+     */
+    uint32_t glitches() const {
+        return m_glitches;
+    }
+
+    /**
+     * Accepted presses shorter than EDGE_CAPTURE_SHORT_PRESS, most likely noise that passed the debounce time
+     */
+    uint32_t shortPresses() const {
+        return m_shortPresses;
+    }
+
+    /**
+     * Let the debounce time adapt to the noise on the line, it stays within p_min and p_max us
+     * Every EDGE_CAPTURE_ADAPT_PERIOD us it goes up when short presses were accepted and down when there were no
+     * glitches at all, so a clean line gets the lowest latency. Equal bounds keep the debounce time fixed
+     */
+    void adaptiveDebounce(uint32_t p_min, uint32_t p_max);
+
+    /**
+     * Current debounce time in us
+     */
+    uint32_t debounce() const {
+        return m_debounce;
+    }
+
+    /**
+     * Loop side, the oldest accepted change that was not read yet, returns false when there is none
+     */
+    bool nextChange(Edge& p_change) {
+        return m_changes.pop(p_change);
+    }
+
+    /**
+     * Edges lost because update(..) was not called in time
+     */
+    uint32_t overflows() const {
+        return m_edges.overflows();
+    }
+
+    /**
+     * Accepted changes lost because nextChange(..) was not called in time
+     */
+    uint32_t changeOverflows() const {
+        return m_changes.overflows();
+    }
+
+private:
+    void accept();
+    void adapt();
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#define FAST_PIN_GPI GPI
+#define FAST_PIN_SET(p_mask) (GPOS = (p_mask))
+#define FAST_PIN_CLEAR(p_mask) (GPOC = (p_mask))
+#else
+// GPIO input and output registers of the host stubs
+extern uint32_t GPIStubbed;
+extern uint32_t GPOStubbed;
+#define FAST_PIN_GPI GPIStubbed
+#define FAST_PIN_SET(p_mask) (GPOStubbed |= (p_mask))
+#define FAST_PIN_CLEAR(p_mask) (GPOStubbed &= ~(p_mask))
+#endif
+
+/**
+ * GPIO 0..15 with the pin and inversion known at compile time
+ *
+ * On the ESP8266 read() is a single load of GPI and write(..) a single store to GPOS or GPOC, instead of
+ * digitalRead and digitalWrite that look up the pin at runtime. It can be used from interrupts.
+ * Set the pin mode with pinMode in setup(), GPIO 16 is not in these registers.
+ */
+template<uint8_t PIN, bool INVERT = false>
+class FastPin {
+    static_assert(PIN < 16, "FastPin only supports GPIO 0..15");
+
+public:
+    static constexpr uint8_t pin = PIN;
+    static constexpr uint32_t mask = 1UL << PIN;
+
+    /**
+     * Level of the pin, inverted when INVERT is set
+     */
+    static inline __attribute__((always_inline)) bool read() {
+        return ((FAST_PIN_GPI & mask) != 0) ^ INVERT;
+    }
+
+    /**
+     * Set the pin to p_value, inverted when INVERT is set
+     */
+    static inline __attribute__((always_inline)) void write(bool p_value) {
+        if (p_value ^ INVERT) {
+            FAST_PIN_SET(mask);
+        } else {
+            FAST_PIN_CLEAR(mask);
+        }
+    }
+};
@@ -0,0 +1,81 @@
+#include "frameclock.h"
+
+FrameClock::FrameClock(uint32_t p_period, CatchUp p_catchUp) :
+    m_period(p_period),
+    m_catchUp(p_catchUp),
+    m_nextStart(0) {
+    resetStats();
+}
+
+void FrameClock::start(uint32_t p_now) {
+    m_nextStart = p_now;
+}
+
+void FrameClock::resetStats() {
+    m_frames = 0;
+
+    for (uint8_t i = 0; i < FRAME_CLOCK_BUCKETS; i++) {
+        m_jitter[i] = 0;
+    }
+
+    m_overruns = 0;
+    m_skipped = 0;
+    m_longestStall = 0;
+    m_stallCause = "";
+    m_section = "";
+    m_sectionTime = 0;
+    m_lastSection = "";
+}
+
+bool FrameClock::tick(uint32_t p_now) {
+    uint32_t late = p_now - m_nextStart;
+
+    // Not due yet, this also handles the wrap of p_now
+    if ((int32_t)late < 0) {
+        return false;
+    }
+
+    // The blamed sections of the frame that just finished
+    m_lastSection = m_section;
+    m_section = "";
+    m_sectionTime = 0;
+
+    uint8_t bucket = 0;
+
+    for (uint32_t v = late; v != 0 && bucket < FRAME_CLOCK_BUCKETS - 1; v >>= 1) {
+        bucket++;
+    }
+
+    m_jitter[bucket]++;
+    m_frames++;
+
+    if (late > m_longestStall) {
+        m_longestStall = late;
+        m_stallCause = m_lastSection;
+    }
+
+    uint32_t missed = late / m_period;
+
+    if (missed == 0 || m_catchUp == CATCH_UP_BURST) {
+        m_nextStart += m_period;
+    } else if (m_catchUp == CATCH_UP_SKIP) {
+        m_nextStart += (missed + 1) * m_period;
+        m_skipped += missed;
+    } else {
+        m_nextStart = p_now + m_period;
+        m_skipped += missed;
+    }
+
+    if (missed > 0) {
+        m_overruns++;
+    }
+
+    return true;
+}
+
+void FrameClock::blame(const char* p_section, uint32_t p_duration) {
+    if (p_duration >= m_sectionTime) {
+        m_section = p_section;
+        m_sectionTime = p_duration;
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Number of jitter buckets, bucket 0 counts frames that started on time and bucket i > 0
+// frames that started 2^(i-1) up to 2^i us late, the last bucket counts everything later
+#define FRAME_CLOCK_BUCKETS 16
+
+/**
+ * Fixed rate frame clock with instrumentation of the start time of each frame
+ *
+ * Call tick(..) from loop() and run a frame when it returns true. Sections that may block call blame(..)
+ * with their duration so a stall can be attributed to the longest section of the frame before it.
+ */
+class FrameClock {
+public:
+    /**
+     * What to do when one or more frames were missed
+     */
+    enum CatchUp : uint8_t {
+        // Drop the missed frames and stay in phase with the original schedule
+        CATCH_UP_SKIP = 0,
+        // Run the missed frames back to back
+        CATCH_UP_BURST = 1,
+        // Drop the missed frames and schedule the next frame one period after now
+        CATCH_UP_RESYNC = 2
+    };
+
+private:
+    const uint32_t m_period;
+    CatchUp m_catchUp;
+    uint32_t m_nextStart;
+
+    uint32_t m_frames;
+    uint32_t m_jitter[FRAME_CLOCK_BUCKETS];
+    uint32_t m_overruns;
+    uint32_t m_skipped;
+    uint32_t m_longestStall;
+    const char* m_stallCause;
+
+    // Longest blamed section of the current and the previous frame
+    const char* m_section;
+    uint32_t m_sectionTime;
+    const char* m_lastSection;
+
+public:
+    /**
+     * p_period in us
+     */
+    FrameClock(uint32_t p_period, CatchUp p_catchUp);
+
+    /**
+     * Start the schedule, the first frame is due immediately
+     */
+    void start(uint32_t p_now);
+
+    /**
+     * Returns true when a frame must run, p_now in us
+     */
+    bool tick(uint32_t p_now);
+
+    /**
+     * Report that p_section took p_duration us in the current frame
+     */
+    void blame(const char* p_section, uint32_t p_duration);
+
+    void catchUp(CatchUp p_catchUp) {
+        m_catchUp = p_catchUp;
+    }
+
+    CatchUp catchUp() const {
+        return m_catchUp;
+    }
+
+    uint32_t frames() const {
+        return m_frames;
+    }
+
+    /**
+     * Number of frames that started in bucket p_bucket, see FRAME_CLOCK_BUCKETS
+     */
+    uint32_t jitter(uint8_t p_bucket) const {
+        return m_jitter[p_bucket];
+    }
+
+    /**
+     * Frames that started one period or more late
+     */
+    uint32_t overruns() const {
+        return m_overruns;
+    }
+
+    /**
+     * Frames that were dropped by CATCH_UP_SKIP or CATCH_UP_RESYNC
+     */
+    uint32_t skipped() const {
+        return m_skipped;
+    }
+
+    /**
+     * Longest time in us a frame started late
+     */
+    uint32_t longestStall() const {
+        return m_longestStall;
+    }
+
+    /**
+     * Longest blamed section of the frame before the longest stall, "" when nothing was blamed
+     */
+    const char* stallCause() const {
+        return m_stallCause;
+    }
+
+    void resetStats();
+};
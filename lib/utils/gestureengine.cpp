@@ -0,0 +1,140 @@
+#include "gestureengine.h"
+
+#include <string.h>
+
+GestureEngine::GestureEngine(uint16_t p_tickPeriod, uint16_t p_longPress, uint16_t p_gap) :
+    m_nodeCount(0),
+    m_gestureCount(0),
+    m_tickPeriod(p_tickPeriod),
+    m_longPress(p_longPress),
+    m_gap(p_gap),
+    m_pressed(false),
+    m_duration(0),
+    m_node(0),
+    m_inGesture(false),
+    m_unmatched(0) {
+    clear();
+}
+
+void GestureEngine::clear() {
+    m_nodes[0] = Node{{-1, -1}, -1};
+    m_nodeCount = 1;
+    m_gestureCount = 0;
+    m_node = 0;
+    m_inGesture = false;
+}
+
+bool GestureEngine::add(const char* p_name, const char* p_code) {
+    size_t length = strlen(p_code);
+
+    if (m_gestureCount == GESTURE_ENGINE_GESTURES || length == 0 || strspn(p_code, ".-") != length) {
+        return false;
+    }
+
+    // Check for room first so a failed add leaves the tree unchanged
+    uint8_t node = 0;
+    size_t existing = 0;
+
+    while (existing < length && m_nodes[node].m_next[p_code[existing] == '-'] >= 0) {
+        node = m_nodes[node].m_next[p_code[existing] == '-'];
+        existing++;
+    }
+
+    if (m_nodeCount + (length - existing) > GESTURE_ENGINE_NODES || (existing == length && m_nodes[node].m_gesture >= 0)) {
+        return false;
+    }
+
+    node = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        int8_t& next = m_nodes[node].m_next[p_code[i] == '-'];
+
+        if (next < 0) {
+            m_nodes[m_nodeCount] = Node{{-1, -1}, -1};
+            next = m_nodeCount++;
+        }
+
+        node = next;
+    }
+
+    strncpy(m_names[m_gestureCount], p_name, GESTURE_ENGINE_NAME_LENGTH - 1);
+    m_names[m_gestureCount][GESTURE_ENGINE_NAME_LENGTH - 1] = 0;
+    m_nodes[node].m_gesture = m_gestureCount;
+    m_gestureCount++;
+    return true;
+}
+
+int8_t GestureEngine::finish() {
+    int8_t gesture = m_node >= 0 ? m_nodes[m_node].m_gesture : -1;
+
+    if (gesture < 0) {
+        m_unmatched++;
+    }
+
+    m_node = 0;
+    m_inGesture = false;
+    return gesture;
+}
+
+int8_t GestureEngine::handle(bool p_pressed) {
+    if (p_pressed == m_pressed) {
+        if (m_duration < UINT16_MAX - m_tickPeriod) {
+            m_duration += m_tickPeriod;
+        }
+
+        if (!m_pressed && m_inGesture && m_duration >= m_gap) {
+            return finish();
+        }
+
+        return -1;
+    }
+
+    m_pressed = p_pressed;
+    uint16_t duration = m_duration;
+    m_duration = m_tickPeriod;
+
+    if (p_pressed) {
+        m_inGesture = true;
+        return -1;
+    }
+
+    // A press finished, one step down the tree
+    if (m_node >= 0) {
+        m_node = m_nodes[m_node].m_next[duration >= m_longPress];
+    }
+
+    // Nothing longer can match, no need to wait for the gap
+    if (m_node < 0 || (m_nodes[m_node].m_next[0] < 0 && m_nodes[m_node].m_next[1] < 0)) {
+        return m_node < 0 ? -1 : finish();
+    }
+
+    return -1;
+}
+
+uint8_t loadGestures(GestureEngine& p_engine, const Properties& p_properties) {
+    const size_t prefixLength = strlen(GESTURE_PROPERTY_PREFIX);
+    p_engine.clear();
+
+    p_properties.forEach([&](const char* p_name, const PropertyValue & p_value) {
+        if (strncmp(p_name, GESTURE_PROPERTY_PREFIX, prefixLength) == 0 && p_value.type() == PropertyValue::STRING) {
+            p_engine.add(p_name + prefixLength, p_value);
+        }
+    });
+
+    return p_engine.size();
+}
+
+bool canAddGesture(const Properties& p_properties, const char* p_name, const char* p_code) {
+    const size_t prefixLength = strlen(GESTURE_PROPERTY_PREFIX);
+    // Timing does not matter, only the tree is checked
+    GestureEngine engine(1, 1, 1);
+
+    p_properties.forEach([&](const char* p_property, const PropertyValue & p_value) {
+        if (strncmp(p_property, GESTURE_PROPERTY_PREFIX, prefixLength) == 0 && p_value.type() == PropertyValue::STRING &&
+            strcmp(p_property + prefixLength, p_name) != 0) {
+            engine.add(p_property + prefixLength, p_value);
+        }
+    });
+
+    return engine.add(p_name, p_code);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stdint.h>
+#include <propertyutils.h>
+
+// Maximum number of gestures, nodes of the pattern tree and length of a gesture name
+#ifndef GESTURE_ENGINE_GESTURES
+#define GESTURE_ENGINE_GESTURES 8
+#endif
+#ifndef GESTURE_ENGINE_NODES
+#define GESTURE_ENGINE_NODES 32
+#endif
+#define GESTURE_ENGINE_NAME_LENGTH 16
+
+// Properties with this prefix are gestures, for example gesture.knock=..-.
+#define GESTURE_PROPERTY_PREFIX "gesture."
+
+/**
+ * Matches sequences of short and long presses of a button, like a knock code
+ *
+ * A gesture is written as a code of '.' for a short and '-' for a long press, "." single, ".." double, "-." long-short.
+ * The codes form a tree, each finished press moves one step down the tree so the cost per tick does not depend on the
+ * number of gestures. A gesture matches when the button stays released for the gap time, or at once when no longer
+ * gesture starts with it.
+ */
+class GestureEngine {
+private:
+    struct Node {
+        // Next node for a short and a long press, -1 when no gesture continues that way
+        int8_t m_next[2];
+        // Gesture that ends in this node, -1 when none
+        int8_t m_gesture;
+    };
+
+    Node m_nodes[GESTURE_ENGINE_NODES];
+    uint8_t m_nodeCount;
+    char m_names[GESTURE_ENGINE_GESTURES][GESTURE_ENGINE_NAME_LENGTH];
+    uint8_t m_gestureCount;
+
+    const uint16_t m_tickPeriod;
+    const uint16_t m_longPress;
+    const uint16_t m_gap;
+
+    bool m_pressed;
+    // Time in ms in the current pressed or released state
+    uint16_t m_duration;
+    // Node of the presses so far, -1 when they do not match any gesture
+    int8_t m_node;
+    bool m_inGesture;
+    uint32_t m_unmatched;
+
+public:
+    /**
+     * p_tickPeriod ms between calls to handle(..), presses of p_longPress ms or longer are long,
+     * a release of p_gap ms ends a gesture
+     */
+    GestureEngine(uint16_t p_tickPeriod, uint16_t p_longPress, uint16_t p_gap);
+
+    /**
+     * Add a gesture, p_code is a sequence of '.' and '-'
+     * Returns false when the code is invalid or there is no room
+     */
+    bool add(const char* p_name, const char* p_code);
+
+    /**
+     * Remove all gestures
+     */
+    void clear();
+
+    /**
+     * Call once per tick with the debounced state of the button
+     * Returns the id of the gesture that matched in this tick, -1 when none
+     */
+    int8_t handle(bool p_pressed);
+
+    uint8_t size() const {
+        return m_gestureCount;
+    }
+
+    const char* name(uint8_t p_gesture) const {
+        return m_names[p_gesture];
+    }
+
+    /**
+     * Sequences of presses that did not match any gesture
+     */
+    uint32_t unmatched() const {
+        return m_unmatched;
+    }
+
+private:
+    int8_t finish();
+};
+
+/**
+ * Replace the gestures of p_engine with all GESTURE_PROPERTY_PREFIX properties
+ * Returns the number of gestures loaded
+ */
+uint8_t loadGestures(GestureEngine& p_engine, const Properties& p_properties);
+
+/**
+ * Check that gesture p_name with p_code can be added to the gestures in p_properties, it replaces a gesture with
+ * the same name. Validate with this before storing a gesture, loadGestures(..) silently skips what does not fit
+ */
+bool canAddGesture(const Properties& p_properties, const char* p_name, const char* p_code);
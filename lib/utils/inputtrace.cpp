@@ -0,0 +1,119 @@
+#include "inputtrace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#define INPUT_TRACE_IRAM IRAM_ATTR
+#else
+#define INPUT_TRACE_IRAM
+#endif
+
+InputTrace::InputTrace(uint16_t p_resolution) :
+    m_runs(),
+    m_count(0),
+    m_resolution(p_resolution),
+    m_recording(false),
+    m_level(false),
+    m_start(0),
+    m_runStart(0) {
+}
+
+void InputTrace::start(bool p_level, uint32_t p_time) {
+    m_recording = false;
+    m_count = 0;
+    m_level = p_level;
+    m_start = p_time;
+    m_runStart = p_time;
+    m_recording = true;
+}
+
+bool INPUT_TRACE_IRAM InputTrace::append(bool p_level, uint32_t p_units) {
+    do {
+        if (full()) {
+            return false;
+        }
+
+        uint16_t units = p_units > INPUT_TRACE_MAX_RUN ? INPUT_TRACE_MAX_RUN : p_units;
+        m_runs[m_count++] = (p_level ? 0x8000 : 0) | units;
+        p_units -= units;
+    } while (p_units > 0);
+
+    return true;
+}
+
+bool INPUT_TRACE_IRAM InputTrace::record(bool p_level, uint32_t p_time) {
+    if (!m_recording || p_level == m_level) {
+        return m_recording;
+    }
+
+    // Whole units only, the remainder counts for the next run so the trace does not drift
+    uint32_t units = (p_time - m_runStart) / m_resolution;
+    m_runStart += units * m_resolution;
+
+    if (!append(m_level, units) || full()) {
+        m_recording = false;
+    }
+
+    m_level = p_level;
+    return m_recording;
+}
+
+void InputTrace::stop(uint32_t p_time) {
+    if (m_recording) {
+        append(m_level, (p_time - m_runStart) / m_resolution);
+    }
+
+    m_recording = false;
+}
+
+size_t InputTrace::format(char* p_buffer, size_t p_size, uint16_t& p_entry) const {
+    size_t pos = 0;
+
+    while (p_entry < m_count) {
+        char entry[8];
+        int length = snprintf(entry, sizeof(entry), "%c%u ", m_runs[p_entry] & 0x8000 ? '+' : '-',
+                              m_runs[p_entry] & INPUT_TRACE_MAX_RUN);
+
+        if (pos + length >= p_size) {
+            break;
+        }
+
+        memcpy(p_buffer + pos, entry, length);
+        pos += length;
+        p_entry++;
+    }
+
+    if (p_size > 0) {
+        p_buffer[pos] = 0;
+    }
+
+    return pos;
+}
+
+bool InputTrace::parse(const char* p_text) {
+    while (*p_text != 0) {
+        if (*p_text == ' ') {
+            p_text++;
+            continue;
+        }
+
+        if (*p_text != '+' && *p_text != '-') {
+            return false;
+        }
+
+        bool level = *p_text == '+';
+        char* end;
+        unsigned long units = strtoul(p_text + 1, &end, 10);
+
+        if (end == p_text + 1 || !append(level, units)) {
+            return false;
+        }
+
+        p_text = end;
+    }
+
+    return true;
+}
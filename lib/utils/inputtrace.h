@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Number of runs a trace can hold, 2 bytes each
+#ifndef INPUT_TRACE_RUNS
+#define INPUT_TRACE_RUNS 256
+#endif
+
+// Longest run of one entry in units of the resolution, longer runs take more entries
+#define INPUT_TRACE_MAX_RUN 0x7fff
+
+/**
+ * Records the raw level of an input as a run length encoded trace, to tune a debouncer against real wiring
+ *
+ * Each entry is 16 bits, the level in the high bit and the length of the run in units of the resolution.
+ * record(..) only stores something when the level changed so it can be called from an interrupt as often as needed.
+ * Read the trace with forEach(..) or format(..) after it was stopped.
+ */
+class InputTrace {
+private:
+    uint16_t m_runs[INPUT_TRACE_RUNS];
+    uint16_t m_count;
+    // us per unit of a run
+    const uint16_t m_resolution;
+    volatile bool m_recording;
+    bool m_level;
+    uint32_t m_start;
+    // Start of the run that is not stored yet
+    uint32_t m_runStart;
+
+public:
+    /**
+     * p_resolution in us per unit
+     */
+    InputTrace(uint16_t p_resolution);
+
+    /**
+     * Clear the trace and start recording at p_time in us with the input at p_level
+     */
+    void start(bool p_level, uint32_t p_time);
+
+    /**
+     * Sample of the input at p_time in us
+     * Returns false when not recording, recording stops when the trace is full
+     */
+    bool record(bool p_level, uint32_t p_time);
+
+    /**
+     * Store the last run up to p_time in us and stop recording
+     */
+    void stop(uint32_t p_time);
+
+    bool recording() const {
+        return m_recording;
+    }
+
+    bool full() const {
+        return m_count == INPUT_TRACE_RUNS;
+    }
+
+    /**
+     * Number of stored entries
+     */
+    uint16_t size() const {
+        return m_count;
+    }
+
+    uint16_t resolution() const {
+        return m_resolution;
+    }
+
+    /**
+     * Time in us the trace started
+     */
+    uint32_t startTime() const {
+        return m_start;
+    }
+
+    /**
+     * Calls p_callback(bool level, uint32_t start, uint32_t duration) for each run, times in us from the start of the trace
+     * Entries of a run longer than INPUT_TRACE_MAX_RUN are combined
+     */
+    template<typename F>
+    void forEach(F p_callback) const {
+        uint32_t time = 0;
+        uint16_t i = 0;
+
+        while (i < m_count) {
+            bool level = m_runs[i] & 0x8000;
+            uint32_t duration = 0;
+
+            do {
+                duration += (uint32_t)(m_runs[i] & INPUT_TRACE_MAX_RUN) * m_resolution;
+                i++;
+            } while (i < m_count && (bool)(m_runs[i] & 0x8000) == level && (m_runs[i - 1] & INPUT_TRACE_MAX_RUN) == INPUT_TRACE_MAX_RUN);
+
+            p_callback(level, time, duration);
+            time += duration;
+        }
+    }
+
+    /**
+     * Write entries from p_entry on as text, "+12" is a high run of 12 units and "-3" a low run of 3 units
+     * Only whole entries are written, p_entry is moved past them so a long trace can be send in parts
+     * Returns the number of characters written, 0 when there is nothing left
+     */
+    size_t format(char* p_buffer, size_t p_size, uint16_t& p_entry) const;
+
+    /**
+     * Append the entries of a text written by format(..), for example to replay a recorded trace
+     * Returns false when the text is invalid or the trace is full
+     */
+    bool parse(const char* p_text);
+
+private:
+    bool append(bool p_level, uint32_t p_units);
+};
@@ -0,0 +1,62 @@
+#include "persistscheduler.h"
+
+static constexpr uint32_t ONE_DAY = 24ul * 60ul * 60ul * 1000ul;
+
+PersistScheduler::PersistScheduler(uint32_t p_quietWindow, uint16_t p_dailyBudget) :
+    m_quietWindow(p_quietWindow),
+    m_dailyBudget(p_dailyBudget),
+    m_pending(false),
+    m_critical(false),
+    m_lastChange(0),
+    m_periodStart(0),
+    m_periodWrites(0),
+    m_writesMade(0),
+    m_writesAvoided(0),
+    m_worstLatency(0) {
+}
+
+void PersistScheduler::changed(uint32_t p_now, bool p_critical) {
+    if (m_pending) {
+        m_writesAvoided++;
+    }
+
+    m_pending = true;
+    m_critical = m_critical || p_critical;
+    m_lastChange = p_now;
+}
+
+bool PersistScheduler::isDue(uint32_t p_now) {
+    if (p_now - m_periodStart >= ONE_DAY) {
+        m_periodStart = p_now;
+        m_periodWrites = 0;
+    }
+
+    if (!m_pending) {
+        return false;
+    }
+
+    if (m_critical) {
+        return true;
+    }
+
+    return p_now - m_lastChange >= m_quietWindow && m_periodWrites < m_dailyBudget;
+}
+
+void PersistScheduler::started() {
+    m_pending = false;
+    m_critical = false;
+}
+
+void PersistScheduler::written(uint32_t p_now, uint32_t p_latency, bool p_success) {
+    m_writesMade++;
+    m_periodWrites++;
+
+    if (p_latency > m_worstLatency) {
+        m_worstLatency = p_latency;
+    }
+
+    if (!p_success) {
+        m_pending = true;
+        m_lastChange = p_now;
+    }
+}
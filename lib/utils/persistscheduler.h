@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Decides when the configuration is written to flash
+ *
+ * Changes are coalesced until nothing changed for the quiet window, so a burst of MQTT commands
+ * results in a single write. At most p_dailyBudget writes are made per fixed 24 hour window, counted from
+ * boot, when the budget is used up the write waits for the next window. A 24 hour span across two
+ * windows can hold up to twice the budget. Critical changes, like new MQTT server
+ * settings from the portal, are written on the next check regardless of the quiet window or budget.
+ *
+ * All times are in ms as returned by millis(), wrap around is handled
+ */
+class PersistScheduler {
+private:
+    const uint32_t m_quietWindow;
+    const uint16_t m_dailyBudget;
+    bool m_pending;
+    bool m_critical;
+    uint32_t m_lastChange;
+    uint32_t m_periodStart;
+    uint16_t m_periodWrites;
+
+    uint32_t m_writesMade;
+    uint32_t m_writesAvoided;
+    uint32_t m_worstLatency;
+
+public:
+    PersistScheduler(uint32_t p_quietWindow, uint16_t p_dailyBudget);
+
+    /**
+     * Register a change that must be persisted
+     */
+    void changed(uint32_t p_now, bool p_critical);
+
+    /**
+     * true when the pending changes must be written now
+     */
+    bool isDue(uint32_t p_now);
+
+    /**
+     * Call when a write starts, changes made while writing are pending for the next write
+     */
+    void started();
+
+    /**
+     * Report a finished write and how long it blocked in us, for writes spread over frames the longest step
+     * A failed write becomes pending again and is retried after the quiet window
+     */
+    void written(uint32_t p_now, uint32_t p_latency, bool p_success);
+
+    bool isPending() const {
+        return m_pending;
+    }
+
+    uint32_t writesMade() const {
+        return m_writesMade;
+    }
+
+    /**
+     * Changes that were coalesced into an other write
+     */
+    uint32_t writesAvoided() const {
+        return m_writesAvoided;
+    }
+
+    /**
+     * Longest time in us a write blocked
+     */
+    uint32_t worstLatency() const {
+        return m_worstLatency;
+    }
+
+    /**
+     * Writes left in the current fixed 24 hour window
+     */
+    uint16_t budgetLeft() const {
+        return m_periodWrites >= m_dailyBudget ? 0 : m_dailyBudget - m_periodWrites;
+    }
+};
@@ -0,0 +1,154 @@
+#include "profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+
+uint32_t profilerCycles() {
+    return ESP.getCycleCount();
+}
+#else
+#include <chrono>
+
+uint32_t profilerCycles() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+Profiler::Profiler(uint32_t p_cyclesPerUs) :
+    m_size(0),
+    m_cyclesPerUs(p_cyclesPerUs) {
+}
+
+uint8_t Profiler::section(const char* p_name) {
+    for (uint8_t i = 0; i < m_size; i++) {
+        if (strcmp(m_sections[i].m_name, p_name) == 0) {
+            return i;
+        }
+    }
+
+    if (m_size == PROFILER_SECTIONS) {
+        return PROFILER_SECTIONS;
+    }
+
+    m_sections[m_size].m_name = p_name;
+    clear(m_sections[m_size]);
+    return m_size++;
+}
+
+void Profiler::clear(Section& p_section) {
+    p_section.m_count = 0;
+    p_section.m_total = 0;
+    p_section.m_min = UINT32_MAX;
+    p_section.m_max = 0;
+    memset(p_section.m_histogram, 0, sizeof(p_section.m_histogram));
+}
+
+void Profiler::reset() {
+    for (uint8_t i = 0; i < m_size; i++) {
+        clear(m_sections[i]);
+    }
+}
+
+uint8_t Profiler::bucket(uint32_t p_cycles) {
+    if (p_cycles < 4) {
+        return p_cycles;
+    }
+
+    uint8_t msb = 31;
+
+    while ((p_cycles & (1UL << msb)) == 0) {
+        msb--;
+    }
+
+    // Two bits below the most significant bit select one of 4 buckets within the power of two
+    uint32_t bucket = (msb - 1) * 4 + ((p_cycles >> (msb - 2)) & 3);
+    return bucket < PROFILER_BUCKETS ? bucket : PROFILER_BUCKETS - 1;
+}
+
+uint32_t Profiler::bucketLimit(uint8_t p_bucket) {
+    if (p_bucket < 4) {
+        return p_bucket;
+    }
+
+    if (p_bucket == PROFILER_BUCKETS - 1) {
+        return UINT32_MAX;
+    }
+
+    uint8_t shift = p_bucket / 4 - 1;
+    return ((uint32_t)(4 + p_bucket % 4 + 1) << shift) - 1;
+}
+
+void Profiler::record(uint8_t p_section, uint32_t p_cycles) {
+    if (p_section >= m_size) {
+        return;
+    }
+
+    Section& section = m_sections[p_section];
+    section.m_count++;
+    section.m_total += p_cycles;
+
+    if (p_cycles < section.m_min) {
+        section.m_min = p_cycles;
+    }
+
+    if (p_cycles > section.m_max) {
+        section.m_max = p_cycles;
+    }
+
+    uint16_t& counter = section.m_histogram[bucket(p_cycles)];
+
+    if (counter != UINT16_MAX) {
+        counter++;
+    }
+}
+
+uint32_t Profiler::min(uint8_t p_section) const {
+    return m_sections[p_section].m_count == 0 ? 0 : m_sections[p_section].m_min;
+}
+
+uint32_t Profiler::average(uint8_t p_section) const {
+    const Section& section = m_sections[p_section];
+    return section.m_count == 0 ? 0 : section.m_total / section.m_count;
+}
+
+uint32_t Profiler::percentile(uint8_t p_section, uint8_t p_percent) const {
+    const Section& section = m_sections[p_section];
+    uint32_t total = 0;
+
+    for (uint8_t i = 0; i < PROFILER_BUCKETS; i++) {
+        total += section.m_histogram[i];
+    }
+
+    // Rank of the measurement, rounded up
+    uint32_t rank = (total * p_percent + 99) / 100;
+    uint32_t seen = 0;
+
+    for (uint8_t i = 0; i < PROFILER_BUCKETS; i++) {
+        seen += section.m_histogram[i];
+
+        if (seen >= rank && seen > 0) {
+            uint32_t limit = bucketLimit(i);
+            return limit < section.m_max ? limit : section.m_max;
+        }
+    }
+
+    return 0;
+}
+
+int Profiler::format(uint8_t p_section, char* p_buffer, size_t p_size) const {
+    const uint32_t values[] = {min(p_section), average(p_section), percentile(p_section, 99), max(p_section)};
+    int pos = snprintf(p_buffer, p_size, "%u", count(p_section));
+
+    for (uint32_t cycles : values) {
+        uint32_t hundredths = (uint64_t)cycles * 100 / m_cyclesPerUs;
+
+        if (pos >= 0 && (size_t)pos < p_size) {
+            pos += snprintf(p_buffer + pos, p_size - pos, "/%u.%02u", hundredths / 100, hundredths % 100);
+        }
+    }
+
+    return pos;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Maximum number of profiled sections
+#ifndef PROFILER_SECTIONS
+#define PROFILER_SECTIONS 12
+#endif
+
+// Histogram buckets, 4 per power of two so a percentile is within 25% of the real value
+// durations of 2^25 cycles and longer end up in the last bucket
+#define PROFILER_BUCKETS 96
+
+/**
+ * Free running cycle counter, ESP.getCycleCount() on the ESP8266 and a nanosecond clock on the host
+ */
+uint32_t profilerCycles();
+
+/**
+ * Execution time statistics of named code sections in CPU cycles
+ *
+ * Use PROFILE_SCOPE(profiler, "name") at the start of a block to measure it. The macro is only
+ * active when PROFILER is defined, otherwise it compiles to nothing.
+ * Histogram counters saturate at 65535, reset(..) the statistics after publishing them
+ */
+class Profiler {
+private:
+    struct Section {
+        const char* m_name;
+        uint32_t m_count;
+        uint64_t m_total;
+        uint32_t m_min;
+        uint32_t m_max;
+        uint16_t m_histogram[PROFILER_BUCKETS];
+    };
+
+    Section m_sections[PROFILER_SECTIONS];
+    uint8_t m_size;
+    const uint32_t m_cyclesPerUs;
+
+public:
+    /**
+     * p_cyclesPerUs converts cycles to us for format(..)
+     */
+    Profiler(uint32_t p_cyclesPerUs);
+
+    /**
+     * Id of the section with p_name, the section is added when it does not exist
+     * Returns PROFILER_SECTIONS when there is no room, record(..) ignores that id
+     */
+    uint8_t section(const char* p_name);
+
+    void record(uint8_t p_section, uint32_t p_cycles);
+
+    uint8_t size() const {
+        return m_size;
+    }
+
+    const char* name(uint8_t p_section) const {
+        return m_sections[p_section].m_name;
+    }
+
+    uint32_t count(uint8_t p_section) const {
+        return m_sections[p_section].m_count;
+    }
+
+    uint32_t min(uint8_t p_section) const;
+
+    uint32_t max(uint8_t p_section) const {
+        return m_sections[p_section].m_max;
+    }
+
+    uint32_t average(uint8_t p_section) const;
+
+    /**
+     * Upper limit of the histogram bucket that holds p_percent of the measurements, never more than max(..)
+     */
+    uint32_t percentile(uint8_t p_section, uint8_t p_percent) const;
+
+    /**
+     * Write count/min/avg/p99/max of a section in us with two decimals
+     * Returns the number of characters written, like snprintf
+     */
+    int format(uint8_t p_section, char* p_buffer, size_t p_size) const;
+
+    /**
+     * Clear the statistics of all sections, the sections stay registered
+     */
+    void reset();
+
+    static uint8_t bucket(uint32_t p_cycles);
+
+    /**
+     * Largest number of cycles that falls in p_bucket
+     */
+    static uint32_t bucketLimit(uint8_t p_bucket);
+
+private:
+    static void clear(Section& p_section);
+};
+
+/**
+ * Measure the cycles between construction and destruction
+ */
+class ProfileScope {
+private:
+    Profiler& m_profiler;
+    const uint8_t m_section;
+    const uint32_t m_start;
+
+public:
+    ProfileScope(Profiler& p_profiler, uint8_t p_section) :
+        m_profiler(p_profiler),
+        m_section(p_section),
+        m_start(profilerCycles()) {
+    }
+
+    ~ProfileScope() {
+        m_profiler.record(m_section, profilerCycles() - m_start);
+    }
+};
+
+#ifdef PROFILER
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+#define PROFILE_SCOPE_(p_profiler, p_name, p_id) \
+    static const uint8_t PROFILER_CONCAT(profileSection, p_id) = (p_profiler).section(p_name); \
+    ProfileScope PROFILER_CONCAT(profileScope, p_id)(p_profiler, PROFILER_CONCAT(profileSection, p_id))
+// The section is looked up once per call site
+#define PROFILE_SCOPE(p_profiler, p_name) PROFILE_SCOPE_(p_profiler, p_name, __COUNTER__)
+#else
+#define PROFILE_SCOPE(p_profiler, p_name)
+#endif
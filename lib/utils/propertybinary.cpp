@@ -0,0 +1,312 @@
+#include "propertybinary.h"
+
+#include <string.h>
+#include <memory>
+#include <crceeprom.h>
+
+static void writeUint16(uint8_t* p_buffer, uint16_t p_value) {
+    p_buffer[0] = p_value & 0xff;
+    p_buffer[1] = p_value >> 8;
+}
+
+static void writeUint32(uint8_t* p_buffer, uint32_t p_value) {
+    writeUint16(p_buffer, p_value & 0xffff);
+    writeUint16(p_buffer + 2, p_value >> 16);
+}
+
+static uint16_t readUint16(const uint8_t* p_buffer) {
+    return p_buffer[0] | (p_buffer[1] << 8);
+}
+
+static uint32_t readUint32(const uint8_t* p_buffer) {
+    return readUint16(p_buffer) | ((uint32_t)readUint16(p_buffer + 2) << 16);
+}
+
+uint16_t propertiesCrc16(const uint8_t* p_buffer, size_t p_length) {
+    uint16_t crc = 0;
+
+    for (size_t i = 0; i < p_length; i++) {
+        crc = CRCEEProm::crc16Update(crc, p_buffer[i]);
+    }
+
+    return crc;
+}
+
+static char typeChar(const PropertyValue& p_value) {
+    switch (p_value.type()) {
+        case PropertyValue::Type::LONG:
+            return 'L';
+
+        case PropertyValue::Type::FLOAT:
+            return 'F';
+
+        case PropertyValue::Type::BOOL:
+            return 'B';
+
+        case PropertyValue::Type::STRING:
+            return 'S';
+    }
+
+    return 0;
+}
+
+static size_t valueSize(const PropertyValue& p_value) {
+    switch (p_value.type()) {
+        case PropertyValue::Type::LONG:
+        case PropertyValue::Type::FLOAT:
+            return 4;
+
+        case PropertyValue::Type::BOOL:
+            return 1;
+
+        case PropertyValue::Type::STRING:
+            return 2 + strlen((const char*)p_value);
+    }
+
+    return 0;
+}
+
+size_t propertyRecordSize(const char* p_name, const PropertyValue& p_value) {
+    return 2 + strlen(p_name) + valueSize(p_value);
+}
+
+size_t propertiesBinarySize(const Properties& p_properties) {
+    size_t size = PROPERTIES_BINARY_HEADER_SIZE;
+    p_properties.forEach([&size](const char* p_name, const PropertyValue & p_value) {
+        size += propertyRecordSize(p_name, p_value);
+    });
+    return size;
+}
+
+size_t serializePropertyRecord(uint8_t* p_buffer, const char* p_name, const PropertyValue& p_value) {
+    uint8_t* ptr = p_buffer;
+    size_t nameLength = strlen(p_name);
+
+    if (nameLength > UINT8_MAX) {
+        return 0;
+    }
+
+    *ptr++ = typeChar(p_value);
+    *ptr++ = nameLength;
+    memcpy(ptr, p_name, nameLength);
+    ptr += nameLength;
+
+    switch (p_value.type()) {
+        case PropertyValue::Type::LONG:
+            writeUint32(ptr, (int32_t)(long)p_value);
+            ptr += 4;
+            break;
+
+        case PropertyValue::Type::FLOAT: {
+            float value = (float)p_value;
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            writeUint32(ptr, bits);
+            ptr += 4;
+        }
+        break;
+
+        case PropertyValue::Type::BOOL:
+            *ptr++ = (bool)p_value ? 1 : 0;
+            break;
+
+        case PropertyValue::Type::STRING: {
+            const char* value = p_value;
+            size_t valueLength = strlen(value);
+            writeUint16(ptr, valueLength);
+            ptr += 2;
+            memcpy(ptr, value, valueLength);
+            ptr += valueLength;
+        }
+        break;
+    }
+
+    return ptr - p_buffer;
+}
+
+size_t serializePropertiesBinary(uint8_t* p_buffer, size_t p_capacity, const Properties& p_properties) {
+    size_t size = propertiesBinarySize(p_properties);
+
+    if (size > p_capacity || size - PROPERTIES_BINARY_HEADER_SIZE > UINT16_MAX) {
+        return 0;
+    }
+
+    bool fits = true;
+    uint8_t* ptr = p_buffer + PROPERTIES_BINARY_HEADER_SIZE;
+    p_properties.forEach([&ptr, &fits](const char* p_name, const PropertyValue & p_value) {
+        size_t size = serializePropertyRecord(ptr, p_name, p_value);
+        fits = fits && size > 0;
+        ptr += size;
+    });
+
+    if (!fits) {
+        return 0;
+    }
+
+    uint16_t length = size - PROPERTIES_BINARY_HEADER_SIZE;
+    p_buffer[0] = 'P';
+    p_buffer[1] = 'B';
+    p_buffer[2] = PROPERTIES_BINARY_VERSION;
+    p_buffer[3] = 0;
+    writeUint16(p_buffer + 4, p_properties.size());
+    writeUint16(p_buffer + 6, length);
+    writeUint16(p_buffer + 8, propertiesCrc16(p_buffer + PROPERTIES_BINARY_HEADER_SIZE, length));
+    return size;
+}
+
+size_t deserializePropertyRecord(const uint8_t* p_buffer, size_t p_length, Properties* p_properties) {
+    const uint8_t* ptr = p_buffer;
+    const uint8_t* end = p_buffer + p_length;
+    char name[UINT8_MAX + 1];
+
+    if (end - ptr < 2) {
+        return 0;
+    }
+
+    char type = *ptr++;
+    uint8_t nameLength = *ptr++;
+
+    if (end - ptr < nameLength) {
+        return 0;
+    }
+
+    memcpy(name, ptr, nameLength);
+    name[nameLength] = 0;
+    ptr += nameLength;
+
+    switch (type) {
+        case 'L':
+            if (end - ptr < 4) {
+                return 0;
+            }
+
+            if (p_properties != nullptr) {
+                p_properties->put(name, PropertyValue((int32_t)readUint32(ptr)));
+            }
+
+            ptr += 4;
+            break;
+
+        case 'F':
+            if (end - ptr < 4) {
+                return 0;
+            }
+
+            if (p_properties != nullptr) {
+                uint32_t bits = readUint32(ptr);
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                p_properties->put(name, PropertyValue(value));
+            }
+
+            ptr += 4;
+            break;
+
+        case 'B':
+            if (end - ptr < 1) {
+                return 0;
+            }
+
+            if (p_properties != nullptr) {
+                p_properties->put(name, PropertyValue(*ptr != 0));
+            }
+
+            ptr += 1;
+            break;
+
+        case 'S': {
+            if (end - ptr < 2) {
+                return 0;
+            }
+
+            uint16_t valueLength = readUint16(ptr);
+            ptr += 2;
+
+            if (end - ptr < valueLength) {
+                return 0;
+            }
+
+            if (p_properties != nullptr) {
+                p_properties->put(name, PropertyValue(reinterpret_cast<const char*>(ptr), valueLength));
+            }
+
+            ptr += valueLength;
+        }
+        break;
+
+        default:
+            return 0;
+    }
+
+    return ptr - p_buffer;
+}
+
+/**
+ * Walk all records, when p_properties is nullptr the records are only validated
+ */
+static bool parseRecords(const uint8_t* p_records, size_t p_length, uint16_t p_count, Properties* p_properties) {
+    size_t offset = 0;
+
+    for (uint16_t i = 0; i < p_count; i++) {
+        size_t size = deserializePropertyRecord(p_records + offset, p_length - offset, p_properties);
+
+        if (size == 0) {
+            return false;
+        }
+
+        offset += size;
+    }
+
+    return offset == p_length;
+}
+
+static bool validHeader(const uint8_t* p_header) {
+    return p_header[0] == 'P' && p_header[1] == 'B' && p_header[2] == PROPERTIES_BINARY_VERSION && p_header[3] == 0;
+}
+
+bool deserializePropertiesBinary(const uint8_t* p_buffer, size_t p_length, Properties& p_properties) {
+    if (p_length < PROPERTIES_BINARY_HEADER_SIZE || !validHeader(p_buffer)) {
+        return false;
+    }
+
+    uint16_t count = readUint16(p_buffer + 4);
+    uint16_t length = readUint16(p_buffer + 6);
+    const uint8_t* records = p_buffer + PROPERTIES_BINARY_HEADER_SIZE;
+
+    if (p_length - PROPERTIES_BINARY_HEADER_SIZE < length ||
+        propertiesCrc16(records, length) != readUint16(p_buffer + 8) ||
+        !parseRecords(records, length, count, nullptr)) {
+        return false;
+    }
+
+    return parseRecords(records, length, count, &p_properties);
+}
+
+bool serializePropertiesBinary(Stream& device, const Properties& p_properties) {
+    size_t size = propertiesBinarySize(p_properties);
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[size]);
+
+    if (serializePropertiesBinary(buffer.get(), size, p_properties) != size) {
+        return false;
+    }
+
+    return device.write(buffer.get(), size) == size;
+}
+
+bool deserializePropertiesBinary(Stream& device, Properties& p_properties) {
+    uint8_t header[PROPERTIES_BINARY_HEADER_SIZE];
+
+    if (device.readBytes(header, sizeof(header)) != sizeof(header) || !validHeader(header)) {
+        return false;
+    }
+
+    uint16_t length = readUint16(header + 6);
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[PROPERTIES_BINARY_HEADER_SIZE + length]);
+    memcpy(buffer.get(), header, sizeof(header));
+
+    if (device.readBytes(buffer.get() + PROPERTIES_BINARY_HEADER_SIZE, length) != length) {
+        return false;
+    }
+
+    return deserializePropertiesBinary(buffer.get(), PROPERTIES_BINARY_HEADER_SIZE + length, p_properties);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <propertyutils.h>
+
+/**
+ * Binary format for Properties, all numbers are little endian
+ *
+ * Header (10 bytes)
+ *   'P' 'B'         magic
+ *   uint8_t         version
+ *   uint8_t         reserved, 0
+ *   uint16_t        number of records
+ *   uint16_t        length of all records in bytes
+ *   uint16_t        CRC16 of all records
+ * Record
+ *   char            type, same as the text format 'L', 'F', 'B' or 'S'
+ *   uint8_t         length of the name
+ *   char[]          name, not null terminated
+ *   value           L and F: 4 bytes, B: 1 byte, S: uint16_t length followed by the characters
+ */
+#define PROPERTIES_BINARY_VERSION 1
+#define PROPERTIES_BINARY_HEADER_SIZE 10
+
+/**
+ * Number of bytes serializePropertiesBinary will need, including the header
+ */
+size_t propertiesBinarySize(const Properties& p_properties);
+
+/**
+ * Serialize into p_buffer, returns the number of bytes written or 0 when p_capacity is to small
+ */
+size_t serializePropertiesBinary(uint8_t* p_buffer, size_t p_capacity, const Properties& p_properties);
+
+/**
+ * Validate p_buffer completely before any property is applied
+ * Returns false and leaves p_properties untouched when the header, CRC or any record is invalid
+ */
+bool deserializePropertiesBinary(const uint8_t* p_buffer, size_t p_length, Properties& p_properties);
+
+/**
+ * Serialize to a stream using a single write
+ */
+bool serializePropertiesBinary(Stream& device, const Properties& p_properties);
+
+/**
+ * Read the header and all records with a single read each, then validate and apply
+ */
+bool deserializePropertiesBinary(Stream& device, Properties& p_properties);
+
+/**
+ * CRC16 as used in the header
+ */
+uint16_t propertiesCrc16(const uint8_t* p_buffer, size_t p_length);
+
+/**
+ * Size of a single record
+ */
+size_t propertyRecordSize(const char* p_name, const PropertyValue& p_value);
+
+/**
+ * Write a single record, p_buffer must hold propertyRecordSize bytes
+ * Returns the number of bytes written or 0 when the name is to long
+ */
+size_t serializePropertyRecord(uint8_t* p_buffer, const char* p_name, const PropertyValue& p_value);
+
+/**
+ * Read a single record and put it in p_properties, when p_properties is nullptr the record is only validated
+ * Returns the number of bytes used or 0 when the record is invalid or truncated
+ */
+size_t deserializePropertyRecord(const uint8_t* p_buffer, size_t p_length, Properties* p_properties);
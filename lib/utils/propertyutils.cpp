@@ -10,63 +10,139 @@
 
 static PropertyValue emptyProperty("0");
 
-PropertyValue::PropertyValue(int32_t p_long) : m_long{p_long}, m_type{Type::LONG} {
+PropertyValue::PropertyValue(int32_t p_long) : m_long{p_long}, m_type{Type::LONG}, m_capacity{0} {
 }
-PropertyValue::PropertyValue(const char* p_char) : m_string{p_char}, m_type{Type::STRING} {
+PropertyValue::PropertyValue(const char* p_char) : m_type{Type::STRING}, m_capacity{0} {
+    assign(p_char, strlen(p_char));
 }
-PropertyValue::PropertyValue(const std::string& p_string) : m_string{p_string}, m_type{Type::STRING} {
+PropertyValue::PropertyValue(const std::string& p_string) : m_type{Type::STRING}, m_capacity{0} {
+    assign(p_string.c_str(), p_string.length());
 }
-PropertyValue::PropertyValue(float p_float) : m_float{p_float}, m_type{Type::FLOAT} {
+PropertyValue::PropertyValue(const char* p_char, size_t p_length) : m_type{Type::STRING}, m_capacity{0} {
+    assign(p_char, p_length);
 }
-PropertyValue::PropertyValue(bool p_bool) : m_bool{p_bool}, m_type{Type::BOOL} {
+PropertyValue::PropertyValue(float p_float) : m_float{p_float}, m_type{Type::FLOAT}, m_capacity{0} {
+}
+PropertyValue::PropertyValue(bool p_bool) : m_bool{p_bool}, m_type{Type::BOOL}, m_capacity{0} {
 }
 
 PropertyValue::~PropertyValue() {
     destroy();
 }
 
-PropertyValue::PropertyValue(const PropertyValue& val) {
+PropertyValue::PropertyValue(const PropertyValue& val) : m_capacity{0} {
     copy(val);
 }
 
+PropertyValue::PropertyValue(PropertyValue&& val) noexcept : m_capacity{0} {
+    move(val);
+}
+
 PropertyValue& PropertyValue::operator=(const PropertyValue& val) {
     // Nothing to do in case of self-assignment
     if (&val != this) {
-        destroy();
         copy(val);
     }
 
     return *this;
 }
 
+PropertyValue& PropertyValue::operator=(PropertyValue&& val) noexcept {
+    if (&val != this) {
+        destroy();
+        move(val);
+    }
+
+    return *this;
+}
+
 void PropertyValue::destroy() {
-    if (m_type == Type::STRING) {
-        m_string.~basic_string();
+    if (m_capacity != 0) {
+        delete[] m_heap;
+        m_capacity = 0;
+    }
+}
+
+/**
+ * Store a string, re-uses the current heap buffer when it´s large enough
+ */
+void PropertyValue::assign(const char* p_char, size_t p_length) {
+    char* buffer;
+
+    if (p_length < PROPERTY_VALUE_INLINE_SIZE && m_capacity == 0) {
+        buffer = m_inline;
+    } else if (p_length < m_capacity) {
+        buffer = m_heap;
+    } else {
+        assert(p_length < UINT16_MAX);
+        destroy();
+        m_heap = new char[p_length + 1];
+        m_capacity = p_length + 1;
+        buffer = m_heap;
     }
+
+    memcpy(buffer, p_char, p_length);
+    buffer[p_length] = 0;
+    m_type = Type::STRING;
 }
 
 void PropertyValue::copy(const PropertyValue& value) {
     switch (value.m_type) {
         case Type::LONG:
+            destroy();
             m_long = value.m_long;
             break;
 
         case Type::FLOAT:
+            destroy();
             m_float = value.m_float;
             break;
 
         case Type::BOOL:
+            destroy();
             m_bool = value.m_bool;
             break;
 
         case Type::STRING:
-            new (&m_string) auto(value.m_string);
+            assign(value.str(), strlen(value.str()));
             break;
     }
 
     m_type = value.m_type;
 }
 
+void PropertyValue::move(PropertyValue& value) {
+    static_assert(sizeof(m_inline) >= sizeof(m_heap), "PROPERTY_VALUE_INLINE_SIZE must hold a pointer");
+    memcpy(m_inline, value.m_inline, sizeof(m_inline));
+    m_type = value.m_type;
+    m_capacity = value.m_capacity;
+    value.m_type = Type::LONG;
+    value.m_long = 0;
+    value.m_capacity = 0;
+}
+
+bool PropertyValue::operator==(const PropertyValue& p_value) const {
+    if (m_type != p_value.m_type) {
+        return false;
+    }
+
+    switch (m_type) {
+        case Type::LONG:
+            return m_long == p_value.m_long;
+
+        case Type::FLOAT:
+            return m_float == p_value.m_float;
+
+        case Type::BOOL:
+            return m_bool == p_value.m_bool;
+
+        case Type::STRING:
+            return strcmp(str(), p_value.str()) == 0;
+    }
+
+    return false;
+}
+
 //////////////////////////////////////////////////////////////////
 // Builders
 PropertyValue PropertyValue::longProperty(const char* p_char) {
@@ -94,7 +170,7 @@ PropertyValue::operator bool() const {
 }
 PropertyValue::operator const char* () const {
     assert(m_type == Type::STRING);
-    return reinterpret_cast<const char*>(m_string.c_str());
+    return str();
 }
 
 //////////////////////////////////////////////////////////////////
@@ -111,11 +187,11 @@ long PropertyValue::asLong() const {
             return m_bool ? 1 : 0;
 
         case Type::STRING:
-            if (m_string.length() == 0) {
+            if (*str() == 0) {
                 return 0L;
             }
 
-            return round(std::atof(m_string.c_str()));
+            return round(std::atof(str()));
             break;
 
         default:
@@ -135,11 +211,11 @@ float PropertyValue::asFloat() const {
             return m_bool ? 1.0f : 0.0f;
 
         case Type::STRING:
-            if (m_string.length() == 0) {
+            if (*str() == 0) {
                 return 0.f;
             }
 
-            return std::atof(m_string.c_str());
+            return std::atof(str());
             break;
 
         default:
@@ -159,11 +235,11 @@ bool PropertyValue::asBool() const {
             return m_bool;
 
         case Type::STRING:
-            if (m_string.length() == 0) {
+            if (*str() == 0) {
                 return false;
             }
 
-            return (bool)PropertyValue::boolProperty(m_string.c_str());
+            return (bool)PropertyValue::boolProperty(str());
             break;
 
         default:
@@ -174,48 +250,283 @@ bool PropertyValue::asBool() const {
 //////////////////////////////////////////////////////////////////
 
 
+Properties::Properties() : m_entries(), m_arena(), m_arenaGarbage(0), m_indexComplete(true), m_indexStale(false),
+    m_erased(false) {
+    rebuildIndex();
+}
+
 void Properties::put(const char* p_entry, const PropertyValue& value) {
-    put(std::string(p_entry), value);
+    auto entry = find(p_entry);
+
+    if (entry != nullptr) {
+        update(*entry, value);
+    } else {
+        insert(p_entry, PropertyValue(value));
+    }
 }
-void Properties::put(const std::string& p_entry, const PropertyValue& value) {
-    auto it = m_type.find(p_entry);
+void Properties::put(const char* p_entry, PropertyValue&& value) {
+    auto entry = find(p_entry);
 
-    if (it != m_type.end()) {
-        m_type.erase(it);
+    if (entry != nullptr) {
+        update(*entry, std::move(value));
+    } else {
+        insert(p_entry, std::move(value));
+    }
+}
+void Properties::update(Entry& p_entry, const PropertyValue& value) {
+    if (p_entry.m_value != value) {
+        p_entry.m_value = value;
+        p_entry.m_dirty = true;
     }
+}
+void Properties::update(Entry& p_entry, PropertyValue&& value) {
+    if (p_entry.m_value != value) {
+        p_entry.m_value = std::move(value);
+        p_entry.m_dirty = true;
+    }
+}
+void Properties::put(const std::string& p_entry, const PropertyValue& value) {
+    put(p_entry.c_str(), value);
+}
+void Properties::put(const std::string& p_entry, PropertyValue&& value) {
+    put(p_entry.c_str(), std::move(value));
+}
 
-    m_type.emplace(p_entry, value);
+bool Properties::putNotContains(const std::string& p_entry, PropertyValue value) {
+    return putNotContains(p_entry.c_str(), std::move(value));
 }
 
-bool Properties::putNotContains(const std::string& p_entry, const PropertyValue& value) {
-    if (!contains(p_entry)) {
-        m_type.emplace(p_entry, value);
+bool Properties::putNotContains(const char* p_entry, PropertyValue value) {
+    if (find(p_entry) == nullptr) {
+        insert(p_entry, std::move(value));
         return true;
     }
 
     return false;
 }
 
-bool Properties::putNotContains(const char* p_entry, const PropertyValue& value) {
-    return putNotContains(std::string(p_entry), value);
-}
-
 void Properties::erase(const std::string& p_entry) {
-    m_type.erase(p_entry);
+    auto entry = find(p_entry.c_str());
+
+    if (entry != nullptr) {
+        m_arenaGarbage += p_entry.length() + 1;
+        m_entries.erase(m_entries.begin() + (entry - m_entries.data()));
+        m_erased = true;
+
+        if (m_arenaGarbage > m_arena.size() / 2) {
+            compactArena();
+        }
+
+        m_indexStale = true;
+    }
 }
 
 bool Properties::contains(const std::string& p_entry) const {
-    return m_type.find(p_entry) != m_type.end();
+    return contains(p_entry.c_str());
+}
+
+bool Properties::contains(const char* p_entry) const {
+    return find(p_entry) != nullptr;
 }
 
 const PropertyValue& Properties::get(const std::string& p_entry) const {
-    if (m_type.find(p_entry) != m_type.end()) {
-        return m_type.at(p_entry);
+    return get(p_entry.c_str());
+}
+
+const PropertyValue& Properties::get(const char* p_entry) const {
+    auto entry = find(p_entry);
+
+    if (entry != nullptr) {
+        return entry->m_value;
+    } else {
+        return emptyProperty;
+    }
+}
+
+void Properties::put(const PropertyKey& p_key, const PropertyValue& value) {
+    auto entry = find(p_key);
+
+    if (entry != nullptr) {
+        update(*entry, value);
+    } else {
+        insert(p_key.name(), PropertyValue(value));
+    }
+}
+
+void Properties::put(const PropertyKey& p_key, PropertyValue&& value) {
+    auto entry = find(p_key);
+
+    if (entry != nullptr) {
+        update(*entry, std::move(value));
+    } else {
+        insert(p_key.name(), std::move(value));
+    }
+}
+
+bool Properties::putNotContains(const PropertyKey& p_key, PropertyValue value) {
+    if (find(p_key) == nullptr) {
+        insert(p_key.name(), std::move(value));
+        return true;
+    }
+
+    return false;
+}
+
+const PropertyValue& Properties::get(const PropertyKey& p_key) const {
+    auto entry = find(p_key);
+
+    if (entry != nullptr) {
+        return entry->m_value;
     } else {
         return emptyProperty;
     }
 }
 
+bool Properties::isDirty(const PropertyKey& p_key) const {
+    auto entry = find(p_key);
+    return entry != nullptr && entry->m_dirty;
+}
+
+bool Properties::isDirty() const {
+    if (m_erased) {
+        return true;
+    }
+
+    for (auto& entry : m_entries) {
+        if (entry.m_dirty) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Properties::clearDirty() {
+    for (auto& entry : m_entries) {
+        entry.m_dirty = false;
+    }
+
+    m_erased = false;
+}
+
+bool Properties::contains(const PropertyKey& p_key) const {
+    return find(p_key) != nullptr;
+}
+
+Properties::Entry* Properties::find(const PropertyKey& p_key) const {
+    constexpr uint32_t mask = PROPERTIES_INDEX_SIZE - 1;
+
+    if (m_indexStale) {
+        const_cast<Properties*>(this)->rebuildIndex();
+    }
+
+    for (uint32_t i = 0; i < PROPERTIES_INDEX_SIZE; i++) {
+        const IndexEntry& slot = m_index[(p_key.hash() + i) & mask];
+
+        if (slot.m_entry == 0) {
+            break;
+        }
+
+        const Entry& entry = m_entries[slot.m_entry - 1];
+
+        // An absent key can have the hash of a stored key, so a hit is always verified by name
+        if (slot.m_hash == p_key.hash() && strcmp(name(entry), p_key.name()) == 0) {
+            return const_cast<Entry*>(&entry);
+        }
+    }
+
+    if (m_indexComplete) {
+        return nullptr;
+    }
+
+    // Index could not hold all keys, fallback to a search by name
+    return find(p_key.name());
+}
+
+Properties::Entry* Properties::find(const char* p_entry) const {
+    auto it = const_cast<Properties*>(this)->lowerBound(p_entry);
+
+    if (it != m_entries.end() && strcmp(name(*it), p_entry) == 0) {
+        return &*it;
+    }
+
+    return nullptr;
+}
+
+std::vector<Properties::Entry>::iterator Properties::lowerBound(const char* p_entry) {
+    return std::lower_bound(m_entries.begin(), m_entries.end(), p_entry, [this](const Entry & entry, const char* p_name) {
+        return strcmp(name(entry), p_name) < 0;
+    });
+}
+
+void Properties::insert(const char* p_entry, PropertyValue&& value) {
+    size_t length = strlen(p_entry) + 1;
+    assert(m_arena.size() + length <= UINT16_MAX);
+
+    uint16_t offset = m_arena.size();
+    m_arena.insert(m_arena.end(), p_entry, p_entry + length);
+    auto position = lowerBound(p_entry);
+    bool append = position == m_entries.end();
+    m_entries.insert(position, Entry{PropertyKey::hash(p_entry), offset, true, std::move(value)});
+
+    // Sorted input, like a file written by serializeProperties, only appends so positions do not shift
+    // Other inserts shift positions, the index is rebuild once on the next lookup instead of on every insert
+    if (!append) {
+        m_indexStale = true;
+    } else if (!m_indexStale) {
+        addToIndex(m_entries.size() - 1);
+    }
+}
+
+void Properties::compactArena() {
+    std::vector<char> arena;
+    arena.reserve(m_arena.size() - m_arenaGarbage);
+
+    for (auto& entry : m_entries) {
+        const char* entryName = name(entry);
+        uint16_t offset = arena.size();
+        arena.insert(arena.end(), entryName, entryName + strlen(entryName) + 1);
+        entry.m_name = offset;
+    }
+
+    m_arena.swap(arena);
+    m_arenaGarbage = 0;
+}
+
+void Properties::addToIndex(uint16_t p_position) {
+    static_assert((PROPERTIES_INDEX_SIZE & (PROPERTIES_INDEX_SIZE - 1)) == 0, "Must be a power of 2");
+    constexpr uint32_t mask = PROPERTIES_INDEX_SIZE - 1;
+    uint32_t hash = m_entries[p_position].m_hash;
+
+    for (uint32_t i = 0; i < PROPERTIES_INDEX_SIZE; i++) {
+        IndexEntry& slot = m_index[(hash + i) & mask];
+
+        if (slot.m_entry == 0) {
+            slot.m_hash = hash;
+            slot.m_entry = p_position + 1;
+            return;
+        }
+    }
+
+    m_indexComplete = false;
+}
+
+void Properties::rebuildIndex() {
+    std::fill(std::begin(m_index), std::end(m_index), IndexEntry{0, 0});
+    m_indexComplete = true;
+    m_indexStale = false;
+
+    for (uint16_t i = 0; i < m_entries.size(); i++) {
+        // Index is full, remaining keys are found by name
+        if (i == PROPERTIES_INDEX_SIZE) {
+            m_indexComplete = false;
+            break;
+        }
+
+        addToIndex(i);
+    }
+}
+
 // https://stackoverflow.com/questions/122616/how-do-i-trim-leading-trailing-whitespace-in-a-standard-way
 char* Properties::stripWS_LT(char* str) {
     char* end;
@@ -251,23 +562,25 @@ char* Properties::getNextNonSpaceChar(char* buffer) {
 }
 
 void Properties::serializeProperties(char* v, size_t desiredCapacity, Stream& device) {
-    for (auto it = m_type.begin(); it != m_type.end(); ++it) {
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        const char* entryName = name(*it);
+        const PropertyValue& value = it->m_value;
 
-        switch (it->second.m_type) {
+        switch (value.m_type) {
             case PropertyValue::Type::LONG:
-                snprintf(v, desiredCapacity, "%s=%c%ld", it->first.c_str(), 'L', (long)it->second);
+                snprintf(v, desiredCapacity, "%s=%c%ld", entryName, 'L', (long)value);
                 break;
 
             case PropertyValue::Type::FLOAT:
-                snprintf(v, desiredCapacity, "%s=%c%g", it->first.c_str(), 'F', (float)it->second);
+                snprintf(v, desiredCapacity, "%s=%c%g", entryName, 'F', (float)value);
                 break;
 
             case PropertyValue::Type::BOOL:
-                snprintf(v, desiredCapacity, "%s=%c%i", it->first.c_str(), 'B', (bool)it->second ? 1 : 0);
+                snprintf(v, desiredCapacity, "%s=%c%i", entryName, 'B', (bool)value ? 1 : 0);
                 break;
 
             case PropertyValue::Type::STRING:
-                snprintf(v, desiredCapacity, "%s=%c%s", it->first.c_str(), 'S', (const char*)it->second);
+                snprintf(v, desiredCapacity, "%s=%c%s", entryName, 'S', (const char*)value);
                 break;
         }
 
@@ -322,4 +635,138 @@ void Properties::deserializeProperties(char* buffer, size_t desiredCapacity, Str
             device.read();
         }
     }
-}
\ No newline at end of file
+}
+
+static const char* skipSpace(const char* p_begin, const char* p_end) {
+    while (p_begin < p_end && isspace((unsigned char)*p_begin)) {
+        p_begin++;
+    }
+
+    return p_begin;
+}
+
+static const char* trimSpace(const char* p_begin, const char* p_end) {
+    while (p_end > p_begin && isspace((unsigned char)p_end[-1])) {
+        p_end--;
+    }
+
+    return p_end;
+}
+
+/**
+ * Parse a number that is not null terminated, returns false when it´s not completely a number
+ */
+static bool parseNumber(const char* p_begin, const char* p_end, char p_type, PropertyValue& p_value) {
+    char number[24];
+    size_t length = p_end - p_begin;
+
+    if (length == 0 || length >= sizeof(number)) {
+        return false;
+    }
+
+    memcpy(number, p_begin, length);
+    number[length] = 0;
+    char* end;
+
+    if (p_type == 'L') {
+        p_value = PropertyValue((int32_t)strtol(number, &end, 10));
+    } else {
+        p_value = PropertyValue(strtof(number, &end));
+    }
+
+    return *end == 0;
+}
+
+size_t deserializeProperties(char* p_buffer, size_t p_length, Properties& p_properties,
+                             std::function<void(const PropertiesParseError&)> p_onError) {
+    size_t errors = 0;
+    uint32_t lineNumber = 0;
+    char* ptr = p_buffer;
+    char* bufferEnd = p_buffer + p_length;
+
+    auto error = [&](PropertiesParseError::Reason p_reason) {
+        errors++;
+
+        if (p_onError) {
+            p_onError(PropertiesParseError{lineNumber, p_reason});
+        }
+    };
+
+    while (ptr < bufferEnd) {
+        lineNumber++;
+        char* lineEnd = static_cast<char*>(memchr(ptr, '\n', bufferEnd - ptr));
+
+        if (lineEnd == nullptr) {
+            lineEnd = bufferEnd;
+        }
+
+        char* line = ptr;
+        ptr = lineEnd + 1;
+
+        const char* nameBegin = skipSpace(line, lineEnd);
+
+        if (nameBegin == lineEnd) {
+            continue;
+        }
+
+        char* separator = static_cast<char*>(memchr(line, '=', lineEnd - line));
+
+        if (separator == nullptr) {
+            error(PropertiesParseError::MISSING_SEPARATOR);
+            continue;
+        }
+
+        char* nameEnd = const_cast<char*>(trimSpace(nameBegin, separator));
+
+        if (nameEnd == nameBegin) {
+            error(PropertiesParseError::EMPTY_NAME);
+            continue;
+        }
+
+        // Null terminate the name in place, the separator or a space is overwritten
+        *nameEnd = 0;
+
+        const char* typePtr = skipSpace(separator + 1, lineEnd);
+        char type = 0;
+        const char* valueBegin = lineEnd;
+
+        if (typePtr < lineEnd) {
+            type = *typePtr;
+            valueBegin = skipSpace(typePtr + 1, lineEnd);
+        }
+
+        const char* valueEnd = trimSpace(valueBegin, lineEnd);
+
+        switch (type) {
+            case 'B': {
+                size_t length = valueEnd - valueBegin;
+                bool value = (length == 4 && memcmp(valueBegin, "true", 4) == 0) ||
+                             (length == 3 && memcmp(valueBegin, "yes", 3) == 0) ||
+                             (length == 1 && *valueBegin == '1');
+                p_properties.put(nameBegin, PropertyValue(value));
+            }
+            break;
+
+            case 'L':
+            case 'F': {
+                PropertyValue value(0);
+
+                if (parseNumber(valueBegin, valueEnd, type, value)) {
+                    p_properties.put(nameBegin, std::move(value));
+                } else {
+                    error(PropertiesParseError::INVALID_NUMBER);
+                }
+            }
+            break;
+
+            case 'S':
+                p_properties.put(nameBegin, PropertyValue(valueBegin, valueEnd - valueBegin));
+                break;
+
+            default:
+                error(PropertiesParseError::UNKNOWN_TYPE);
+        }
+    }
+
+    return errors;
+}
@@ -1,28 +1,89 @@
 #pragma once
 #include <string>
 #include <stdint.h>
-#include <map>
+#include <vector>
+#include <functional>
 #include <Stream.h>
 
 class Properties;
 
+// Number of slots in the hash index of Properties, must be a power of 2
+#ifndef PROPERTIES_INDEX_SIZE
+#define PROPERTIES_INDEX_SIZE 32
+#endif
+
+/**
+ * Name of a property with it´s hash calculated at compile time
+ * Declare them as constexpr so lookups in the hot path do not need to create a std::string
+ * and can be found in the hash index of Properties with a single string compare
+ * constexpr PropertyKey RINGER_ON{"ringerOn"};
+ */
+class PropertyKey {
+private:
+    const char* m_name;
+    uint32_t m_hash;
+
+public:
+    constexpr explicit PropertyKey(const char* p_name) : m_name(p_name), m_hash(hash(p_name)) {
+    }
+
+    constexpr const char* name() const {
+        return m_name;
+    }
+
+    constexpr uint32_t hash() const {
+        return m_hash;
+    }
+
+    /**
+     * FNV-1a hash of a string, usable at compile time and at runtime
+     */
+    static constexpr uint32_t hash(const char* p_name, uint32_t p_hash = 2166136261u) {
+        return *p_name == 0 ? p_hash : hash(p_name + 1, (p_hash ^ (uint8_t)*p_name) * 16777619u);
+    }
+};
+
+// Strings shorter than this are stored inside PropertyValue itself, longer strings go on the heap
+#ifndef PROPERTY_VALUE_INLINE_SIZE
+#define PROPERTY_VALUE_INLINE_SIZE 24
+#endif
+
+/**
+ * Value of a property, short strings such as topics, hostnames and passwords are stored inline
+ * so they do not need a heap allocation
+ */
 class PropertyValue {
 private:
     union {
         int32_t m_long;
         float m_float;
-        std::string m_string;
         bool m_bool;
+        char* m_heap;
+        char m_inline[PROPERTY_VALUE_INLINE_SIZE];
     };
 
-    enum Type {
+public:
+    enum Type : uint8_t {
         LONG,
         FLOAT,
         STRING,
         BOOL
-    } m_type;
+    };
+
+private:
+    Type m_type;
+    // Size of the buffer at m_heap, 0 when the string is stored in m_inline
+    uint16_t m_capacity;
     friend class Properties;
 
+    const char* str() const {
+        return m_capacity == 0 ? m_inline : m_heap;
+    }
+    void assign(const char* p_char, size_t p_length);
+    void copy(const PropertyValue&);
+    void move(PropertyValue&);
+    void destroy();
+
 public:
     friend void serializeProperties(char* v, std::size_t desiredCapacity, Stream& device, const Properties& p);
 
@@ -30,17 +91,16 @@ public:
     explicit PropertyValue(int32_t p_long);
     explicit PropertyValue(const char* p_char);
     explicit PropertyValue(const std::string& p_string);
+    explicit PropertyValue(const char* p_char, size_t p_length);
     explicit PropertyValue(float p_float);
     explicit PropertyValue(bool p_bool);
 
-    virtual ~PropertyValue();
+    ~PropertyValue();
 
     PropertyValue(const PropertyValue& val);
+    PropertyValue(PropertyValue&& val) noexcept;
     PropertyValue& operator=(const PropertyValue& val);
-
-    void copy(const PropertyValue&);
-    void destroy();
-
+    PropertyValue& operator=(PropertyValue&& val) noexcept;
 
     // Create a long properety from string
     static PropertyValue longProperty(const char* p_char);
@@ -53,6 +113,18 @@ public:
     float asFloat() const;
     long asLong() const;
 
+    Type type() const {
+        return m_type;
+    }
+
+    /**
+     * Values are equal when they have the same type and value
+     */
+    bool operator==(const PropertyValue& p_value) const;
+    bool operator!=(const PropertyValue& p_value) const {
+        return !(*this == p_value);
+    }
+
     //////////////////////////////////////////////////////////////////
 
 
@@ -96,12 +168,43 @@ public:
 
 };
 
+/**
+ * Properties are stored in a flat vector sorted by name, the names itself live in a single arena
+ * Updates of an existing key are done in place so in steady state put(..) does not allocate
+ * The arena is compacted when erased names take up more than half of it
+ */
 class Properties {
 private:
+    struct Entry {
+        uint32_t m_hash;
+        // Offset of the null terminated name in m_arena
+        uint16_t m_name;
+        // Added or changed since the last clearDirty()
+        bool m_dirty;
+        PropertyValue m_value;
+    };
+
+    struct IndexEntry {
+        uint32_t m_hash;
+        // Position in m_entries + 1, 0 when the slot is empty
+        uint16_t m_entry;
+    };
 
-    std::map<std::string, const PropertyValue> m_type;
+    std::vector<Entry> m_entries;
+    std::vector<char> m_arena;
+    // Bytes in m_arena of names that are erased
+    uint16_t m_arenaGarbage;
+    // Open addressing index from key hash to it´s entry
+    IndexEntry m_index[PROPERTIES_INDEX_SIZE];
+    // false when a key did not fit, lookups by PropertyKey that miss then search by name
+    bool m_indexComplete;
+    // Positions in m_index are outdated by an insert in the middle or an erase, rebuild on the next lookup
+    bool m_indexStale;
+    // A key was erased since the last clearDirty()
+    bool m_erased;
 
 public:
+    Properties();
     template<std::size_t desiredCapacity>
     friend void serializeProperties(Stream& device, Properties& properties);
     template<std::size_t desiredCapacity>
@@ -110,13 +213,93 @@ public:
     void erase(const std::string& p_entry);
 
     void put(const std::string& p_entry, const PropertyValue& value);
+    void put(const std::string& p_entry, PropertyValue&& value);
     void put(const char* p_entry, const PropertyValue& value);
-    bool putNotContains(const std::string& p_entry, const PropertyValue& value);
-    bool putNotContains(const char* p_entry, const PropertyValue& value);
+    void put(const char* p_entry, PropertyValue&& value);
+    bool putNotContains(const std::string& p_entry, PropertyValue value);
+    bool putNotContains(const char* p_entry, PropertyValue value);
     const PropertyValue& get(const std::string& p_entry) const;
+    const PropertyValue& get(const char* p_entry) const;
     bool contains(const std::string& p_entry) const;
+    bool contains(const char* p_entry) const;
+
+    /**
+     * Lookups by PropertyKey use the hash index and do not allocate
+     */
+    void put(const PropertyKey& p_key, const PropertyValue& value);
+    void put(const PropertyKey& p_key, PropertyValue&& value);
+    bool putNotContains(const PropertyKey& p_key, PropertyValue value);
+    const PropertyValue& get(const PropertyKey& p_key) const;
+    bool contains(const PropertyKey& p_key) const;
+
+    /**
+     * Call p_callback(const char* name, const PropertyValue& value) for each property ordered by name
+     */
+    template<typename F>
+    void forEach(F p_callback) const {
+        for (auto& entry : m_entries) {
+            p_callback(name(entry), entry.m_value);
+        }
+    }
+
+    /**
+     * Keys are dirty when they are added or put(..) with a different value
+     * Putting the same value again does not make a key dirty
+     */
+    bool isDirty(const PropertyKey& p_key) const;
+    /**
+     * true when any key is dirty or was erased
+     */
+    bool isDirty() const;
+    void clearDirty();
+
+    /**
+     * Call p_callback(const char* name, const PropertyValue& value) for each dirty property ordered by name
+     */
+    template<typename F>
+    void forEachDirty(F p_callback) const {
+        for (auto& entry : m_entries) {
+            if (entry.m_dirty) {
+                p_callback(name(entry), entry.m_value);
+            }
+        }
+    }
+
+    /**
+     * true when a key was erased since the last clearDirty()
+     */
+    bool isErased() const {
+        return m_erased;
+    }
+
+    /**
+     * Number of properties stored
+     */
+    size_t size() const {
+        return m_entries.size();
+    }
+
+    /**
+     * Size of the name arena in bytes, including names that are erased but not yet compacted
+     */
+    size_t arenaSize() const {
+        return m_arena.size();
+    }
 
 private:
+    const char* name(const Entry& p_entry) const {
+        return &m_arena[p_entry.m_name];
+    }
+    void update(Entry& p_entry, const PropertyValue& value);
+    void update(Entry& p_entry, PropertyValue&& value);
+    Entry* find(const PropertyKey& p_key) const;
+    Entry* find(const char* p_entry) const;
+    std::vector<Entry>::iterator lowerBound(const char* p_entry);
+    void insert(const char* p_entry, PropertyValue&& value);
+    void compactArena();
+    void addToIndex(uint16_t p_position);
+    void rebuildIndex();
+
     char* stripWS_LT(char* str);
     char* getNextNonSpaceChar(char* buffer);
     void serializeProperties(char* v, size_t desiredCapacity, Stream& device);
@@ -135,4 +318,32 @@ void deserializeProperties(Stream& device, Properties& p) {
     static_assert(desiredCapacity > 0, "Must be > 0");
     char buffer[desiredCapacity];
     p.deserializeProperties(buffer, desiredCapacity, device);
-}
\ No newline at end of file
+}
+
+/**
+ * Error reported by deserializeProperties for a line that could not be parsed
+ */
+struct PropertiesParseError {
+    enum Reason : uint8_t {
+        // Line has no '='
+        MISSING_SEPARATOR,
+        // Nothing before the '='
+        EMPTY_NAME,
+        // Type is not one of B, L, F or S
+        UNKNOWN_TYPE,
+        // Value of a L or F type is not a number
+        INVALID_NUMBER
+    };
+    // First line is 1
+    uint32_t line;
+    Reason reason;
+};
+
+/**
+ * Parse the text format from a contiguous block of memory, for example a whole file read
+ * Names are tokenized in place so p_buffer is modified, values can have any length
+ * Lines that cannot be parsed are skipped and reported to p_onError
+ * Returns the number of lines with errors
+ */
+size_t deserializeProperties(char* p_buffer, size_t p_length, Properties& p_properties,
+                             std::function<void(const PropertiesParseError&)> p_onError = nullptr);
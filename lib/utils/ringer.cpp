@@ -0,0 +1,133 @@
+#include "ringer.h"
+
+#ifndef UNIT_TEST
+#include <Arduino.h>
+#define RINGER_IRAM IRAM_ATTR
+#else
+#define RINGER_IRAM
+#endif
+
+// us per tick
+#define RINGER_TICK_PERIOD 1000
+
+Ringer::Ringer() :
+    m_mailbox(),
+    m_configured(),
+    m_configuredMask(0),
+    m_ticks(0),
+    m_relay(false),
+    m_enabled(false),
+    m_maxRingTime(0),
+    m_cadenceOn(0),
+    m_cadenceOff(0),
+    m_ringing(false),
+    m_ringStart(0),
+    m_rings(0),
+    m_truncated(0),
+    m_lastLatency(0),
+    m_maxLatency(0),
+    m_lastDuration(0) {
+}
+
+bool Ringer::post(Command p_command, uint32_t p_arg) {
+    return m_mailbox.push(Message{p_command, p_arg, m_ticks});
+}
+
+bool Ringer::configure(bool p_enabled, uint32_t p_maxRingTime, uint16_t p_cadenceOn, uint16_t p_cadenceOff) {
+    const uint32_t args[] = {p_enabled, p_maxRingTime, ((uint32_t)p_cadenceOn << 16) | p_cadenceOff};
+    bool posted = true;
+
+    for (uint8_t i = 0; i < 3; i++) {
+        if ((m_configuredMask & (1 << i)) && m_configured[i] == args[i]) {
+            continue;
+        }
+
+        if (post((Command)(RINGER_ENABLE + i), args[i])) {
+            m_configured[i] = args[i];
+            m_configuredMask |= 1 << i;
+        } else {
+            posted = false;
+        }
+    }
+
+    return posted;
+}
+
+void RINGER_IRAM Ringer::stop() {
+    if (m_ringing) {
+        m_ringing = false;
+        m_lastDuration = m_ticks - m_ringStart;
+    }
+}
+
+void RINGER_IRAM Ringer::apply(const Message& p_message) {
+    switch (p_message.m_command) {
+        case RINGER_PRESS:
+            if (m_enabled && !m_ringing) {
+                m_ringing = true;
+                m_ringStart = m_ticks;
+                m_rings = m_rings + 1;
+                m_lastLatency = p_message.m_arg + (m_ticks - p_message.m_posted) * RINGER_TICK_PERIOD;
+
+                if (m_lastLatency > m_maxLatency) {
+                    m_maxLatency = m_lastLatency;
+                }
+            }
+
+            break;
+
+        case RINGER_RELEASE:
+            stop();
+            break;
+
+        case RINGER_ENABLE:
+            m_enabled = p_message.m_arg != 0;
+
+            if (!m_enabled) {
+                stop();
+            }
+
+            break;
+
+        case RINGER_MAX_TIME:
+            m_maxRingTime = p_message.m_arg;
+            break;
+
+        case RINGER_CADENCE:
+            m_cadenceOn = p_message.m_arg >> 16;
+            m_cadenceOff = p_message.m_arg & 0xFFFF;
+            break;
+    }
+}
+
+void RINGER_IRAM Ringer::button(bool p_pressed, uint32_t p_age) {
+    apply(Message{p_pressed ? RINGER_PRESS : RINGER_RELEASE, p_age, m_ticks});
+}
+
+bool RINGER_IRAM Ringer::tick() {
+    m_ticks = m_ticks + 1;
+
+    Message message;
+
+    while (m_mailbox.pop(message)) {
+        apply(message);
+    }
+
+    bool relay = false;
+
+    if (m_ringing) {
+        uint32_t elapsed = m_ticks - m_ringStart;
+
+        if (elapsed >= m_maxRingTime) {
+            stop();
+            m_truncated = m_truncated + 1;
+        } else if (m_cadenceOn == 0 || m_cadenceOff == 0) {
+            relay = true;
+        } else {
+            relay = elapsed % (m_cadenceOn + m_cadenceOff) < m_cadenceOn;
+        }
+    }
+
+    m_relay = relay;
+    return relay;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+#include <spscqueue.h>
+
+// Number of commands that can wait for the next tick
+#ifndef RINGER_MAILBOX_SIZE
+#define RINGER_MAILBOX_SIZE 8
+#endif
+
+/**
+ * Ringer that owns the relay, driven by a 1ms timer interrupt so its timing does not depend on the main loop
+ *
+ * The loop posts commands, tick() applies them and returns the state of the relay. A ring lasts while the button is
+ * pressed and never longer than the max ring time, optionally switching the relay on and off in a cadence.
+ * With a debounced button in interrupt context button(..) starts and stops the ring without waiting for the loop.
+ */
+class Ringer {
+public:
+    enum Command : uint8_t {
+        // Button pressed, start ringing when enabled, arg is the age of the press in us when posted
+        RINGER_PRESS,
+        // Button released, stop ringing
+        RINGER_RELEASE,
+        // Enable or disable ringing, arg 0 or 1
+        RINGER_ENABLE,
+        // Max ring time in ms
+        RINGER_MAX_TIME,
+        // Cadence, arg is the on time in ms in the high 16 bits and the off time in the low 16 bits, 0 rings continuously
+        RINGER_CADENCE
+    };
+
+private:
+    struct Message {
+        Command m_command;
+        uint32_t m_arg;
+        // Tick at which the message was posted
+        uint32_t m_posted;
+    };
+
+    SpscQueue<Message, RINGER_MAILBOX_SIZE> m_mailbox;
+    // Only accessed from configure(..), args of RINGER_ENABLE up to RINGER_CADENCE that were posted
+    uint32_t m_configured[3];
+    uint8_t m_configuredMask;
+    volatile uint32_t m_ticks;
+    volatile bool m_relay;
+
+    // Only accessed from tick()
+    bool m_enabled;
+    uint32_t m_maxRingTime;
+    uint16_t m_cadenceOn;
+    uint16_t m_cadenceOff;
+    bool m_ringing;
+    uint32_t m_ringStart;
+
+    volatile uint32_t m_rings;
+    volatile uint32_t m_truncated;
+    volatile uint32_t m_lastLatency;
+    volatile uint32_t m_maxLatency;
+    volatile uint32_t m_lastDuration;
+
+public:
+    Ringer();
+
+    /**
+     * Loop side, returns false when the mailbox is full
+     */
+    bool post(Command p_command, uint32_t p_arg = 0);
+
+    /**
+     * Loop side, post the settings that differ from what was posted before
+     * Returns false when a command did not fit in the mailbox, call again later to post the rest
+     */
+    bool configure(bool p_enabled, uint32_t p_maxRingTime, uint16_t p_cadenceOn, uint16_t p_cadenceOff);
+
+    /**
+     * Interrupt side, call once per ms
+     * Returns true when the relay must be on
+     */
+    bool tick();
+
+    /**
+     * Interrupt side, same as posting RINGER_PRESS or RINGER_RELEASE
+     * p_age is the time in us since the first edge of the press, it is the latency of the ring
+     */
+    void button(bool p_pressed, uint32_t p_age);
+
+    bool relay() const {
+        return m_relay;
+    }
+
+    /**
+     * Number of rings and rings that were stopped by the max ring time
+     */
+    uint32_t rings() const {
+        return m_rings;
+    }
+
+    uint32_t truncated() const {
+        return m_truncated;
+    }
+
+    /**
+     * us between the press and the relay switching on, last and max
+     * The press starts at its first edge with button(..) and at the age passed to RINGER_PRESS
+     */
+    uint32_t lastLatency() const {
+        return m_lastLatency;
+    }
+
+    uint32_t maxLatency() const {
+        return m_maxLatency;
+    }
+
+    /**
+     * Duration of the last finished ring in ms
+     */
+    uint32_t lastDuration() const {
+        return m_lastDuration;
+    }
+
+    uint32_t mailboxOverflows() const {
+        return m_mailbox.overflows();
+    }
+
+private:
+    void apply(const Message& p_message);
+    void stop();
+};
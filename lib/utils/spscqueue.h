@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Queue operations are forced inline so they end up in the IRAM of the interrupt handler that uses them
+#define SPSC_QUEUE_INLINE inline __attribute__((always_inline))
+
+/**
+ * Lock free queue between a single producer and a single consumer, for example the main loop and an interrupt handler
+ *
+ * Each index is only written by one side, the fences keep the compiler from moving the item copy past the index update.
+ * That is enough on the single core ESP8266 where the only concurrency is an interrupt.
+ * N must be a power of two and at most 128, the queue holds N items.
+ */
+template<typename T, uint8_t N>
+class SpscQueue {
+    static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0, "N must be a power of two up to 128");
+
+private:
+    T m_items[N];
+    // Free running, the difference is the number of items
+    volatile uint8_t m_head;
+    volatile uint8_t m_tail;
+    volatile uint32_t m_overflows;
+
+public:
+    SpscQueue() :
+        m_head(0),
+        m_tail(0),
+        m_overflows(0) {
+    }
+
+    /**
+     * Producer side, returns false and counts an overflow when the queue is full
+     */
+    SPSC_QUEUE_INLINE bool push(const T& p_item) {
+        uint8_t head = m_head;
+
+        if ((uint8_t)(head - m_tail) == N) {
+            m_overflows = m_overflows + 1;
+            return false;
+        }
+
+        m_items[head & (N - 1)] = p_item;
+        std::atomic_signal_fence(std::memory_order_release);
+        m_head = head + 1;
+        return true;
+    }
+
+    /**
+     * Consumer side, returns false when the queue is empty
+     */
+    SPSC_QUEUE_INLINE bool pop(T& p_item) {
+        uint8_t tail = m_tail;
+
+        if (tail == m_head) {
+            return false;
+        }
+
+        std::atomic_signal_fence(std::memory_order_acquire);
+        p_item = m_items[tail & (N - 1)];
+        std::atomic_signal_fence(std::memory_order_release);
+        m_tail = tail + 1;
+        return true;
+    }
+
+    SPSC_QUEUE_INLINE uint8_t size() const {
+        return m_head - m_tail;
+    }
+
+    SPSC_QUEUE_INLINE bool empty() const {
+        return m_head == m_tail;
+    }
+
+    /**
+     * Number of items that did not fit
+     */
+    uint32_t overflows() const {
+        return m_overflows;
+    }
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Minimal file storage used to persist the configuration
+ * Implemented on top of LittleFS on the device and in memory for tests
+ */
+class Storage {
+public:
+    virtual ~Storage() {
+    }
+
+    virtual bool exists(const char* p_name) = 0;
+    /**
+     * Size of a file in bytes, 0 when it does not exists
+     */
+    virtual size_t size(const char* p_name) = 0;
+    /**
+     * Read up to p_length bytes starting at p_offset, returns the number of bytes read
+     */
+    virtual size_t read(const char* p_name, size_t p_offset, uint8_t* p_buffer, size_t p_length) = 0;
+    /**
+     * Create or truncate a file and write p_buffer, returns the number of bytes written
+     */
+    virtual size_t write(const char* p_name, const uint8_t* p_buffer, size_t p_length) = 0;
+    /**
+     * Add p_buffer to the end of a file, the file is created when needed
+     */
+    virtual size_t append(const char* p_name, const uint8_t* p_buffer, size_t p_length) = 0;
+    virtual bool remove(const char* p_name) = 0;
+    /**
+     * Commit buffered appends, call once after a batch of appends instead of after every append
+     */
+    virtual void flush() {
+    }
+};
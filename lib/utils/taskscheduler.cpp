@@ -0,0 +1,110 @@
+#include "taskscheduler.h"
+
+// Tasks that can be due in a single frame
+#define TASK_SCHEDULER_MAX_DUE 16
+
+TaskScheduler::TaskScheduler(uint32_t p_frameBudget, std::function<uint32_t()> p_micros) :
+    m_tasks(),
+    m_micros(p_micros),
+    m_frameBudget(p_frameBudget),
+    m_longestTask(""),
+    m_longestTaskTime(0) {
+}
+
+uint8_t TaskScheduler::add(const char* p_name, uint32_t p_period, uint8_t p_priority, uint32_t p_deadline, uint32_t p_budget,
+                           std::function<void()> p_callback, std::function<bool()> p_pending) {
+    m_tasks.push_back(Task{p_name, p_period, p_priority, p_deadline, p_budget, p_callback, p_pending, 0, false, 0, false, Stats{0, 0, 0, 0, 0}});
+    return m_tasks.size() - 1;
+}
+
+void TaskScheduler::resetStats() {
+    for (auto& task : m_tasks) {
+        task.m_stats = Stats{0, 0, 0, 0, 0};
+    }
+}
+
+int32_t TaskScheduler::slack(const Task& p_task, uint32_t p_now) const {
+    return (int32_t)(p_task.m_dueSince + p_task.m_deadline - p_now);
+}
+
+bool TaskScheduler::isDue(Task& p_task, uint32_t p_now) {
+    bool due = !p_task.m_hasRun || p_now - p_task.m_lastRun >= p_task.m_period || (p_task.m_pending && p_task.m_pending());
+
+    if (due && !p_task.m_isDue) {
+        p_task.m_isDue = true;
+        p_task.m_dueSince = p_now;
+    }
+
+    return due;
+}
+
+uint8_t TaskScheduler::run(uint32_t p_now) {
+    uint8_t due[TASK_SCHEDULER_MAX_DUE];
+    uint8_t dueCount = 0;
+
+    for (uint8_t i = 0; i < m_tasks.size() && dueCount < TASK_SCHEDULER_MAX_DUE; i++) {
+        if (isDue(m_tasks[i], p_now)) {
+            // Insertion sort, highest priority first then the least slack
+            uint8_t position = dueCount++;
+
+            for (; position > 0; position--) {
+                const Task& other = m_tasks[due[position - 1]];
+
+                if (other.m_priority > m_tasks[i].m_priority ||
+                    (other.m_priority == m_tasks[i].m_priority && slack(other, p_now) <= slack(m_tasks[i], p_now))) {
+                    break;
+                }
+
+                due[position] = due[position - 1];
+            }
+
+            due[position] = i;
+        }
+    }
+
+    uint32_t frameStart = m_micros();
+    uint8_t ran = 0;
+    m_longestTask = "";
+    m_longestTaskTime = 0;
+
+    for (uint8_t i = 0; i < dueCount; i++) {
+        Task& task = m_tasks[due[i]];
+        int32_t taskSlack = slack(task, p_now);
+        uint32_t elapsed = m_micros() - frameStart;
+
+        if (ran > 0 && taskSlack > 0 && elapsed + task.m_budget > m_frameBudget) {
+            continue;
+        }
+
+        if (taskSlack < 0) {
+            task.m_stats.deadlineMisses++;
+        }
+
+        uint32_t start = m_micros();
+        task.m_callback();
+        uint32_t duration = m_micros() - start;
+
+        task.m_lastRun = p_now;
+        task.m_hasRun = true;
+        task.m_isDue = false;
+        task.m_stats.runs++;
+        task.m_stats.total += duration;
+
+        if (duration > task.m_stats.max) {
+            task.m_stats.max = duration;
+        }
+
+        if (duration >= m_longestTaskTime) {
+            m_longestTask = task.m_name;
+            m_longestTaskTime = duration;
+        }
+
+        if (duration > task.m_budget) {
+            task.m_stats.overruns++;
+        }
+
+        ran++;
+    }
+
+    return ran;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <functional>
+
+/**
+ * Cooperative scheduler for the maintenance work of the main loop, call run(..) once per frame
+ *
+ * A task is due when p_period ms passed since it last ran, or every frame when p_pending returns true,
+ * for example when network data is waiting. Due tasks run by priority, then by the nearest deadline.
+ * A task only starts when its budget fits in what is left of the frame budget, except the first task
+ * of a frame and tasks that passed their deadline so nothing starves.
+ */
+class TaskScheduler {
+public:
+    struct Stats {
+        uint32_t runs;
+        // Execution time in us
+        uint32_t total;
+        uint32_t max;
+        // Runs that took longer than the budget of the task
+        uint32_t overruns;
+        // Runs that started after the deadline
+        uint32_t deadlineMisses;
+    };
+
+private:
+    struct Task {
+        const char* m_name;
+        uint32_t m_period;
+        uint8_t m_priority;
+        uint32_t m_deadline;
+        uint32_t m_budget;
+        std::function<void()> m_callback;
+        std::function<bool()> m_pending;
+        uint32_t m_lastRun;
+        bool m_hasRun;
+        // Frame in which the task was found due, valid when m_isDue is set
+        uint32_t m_dueSince;
+        bool m_isDue;
+        Stats m_stats;
+    };
+
+    std::vector<Task> m_tasks;
+    std::function<uint32_t()> m_micros;
+    const uint32_t m_frameBudget;
+    // Longest task of the last run(..)
+    const char* m_longestTask;
+    uint32_t m_longestTaskTime;
+
+public:
+    /**
+     * p_frameBudget us per frame, p_micros is the time source for budgets and statistics
+     */
+    TaskScheduler(uint32_t p_frameBudget, std::function<uint32_t()> p_micros);
+
+    /**
+     * Add a task, p_period and p_deadline in ms, p_budget in us, higher p_priority runs first
+     * p_deadline is counted from the moment the task became due
+     * Returns the id of the task
+     */
+    uint8_t add(const char* p_name, uint32_t p_period, uint8_t p_priority, uint32_t p_deadline, uint32_t p_budget,
+                std::function<void()> p_callback, std::function<bool()> p_pending = nullptr);
+
+    /**
+     * Run the due tasks of this frame, p_now in ms
+     * Returns the number of tasks that ran
+     */
+    uint8_t run(uint32_t p_now);
+
+    size_t size() const {
+        return m_tasks.size();
+    }
+
+    const char* name(uint8_t p_task) const {
+        return m_tasks[p_task].m_name;
+    }
+
+    const Stats& stats(uint8_t p_task) const {
+        return m_tasks[p_task].m_stats;
+    }
+
+    /**
+     * Name and execution time in us of the longest task of the last run(..), "" when no task ran
+     */
+    const char* longestTask() const {
+        return m_longestTask;
+    }
+
+    uint32_t longestTaskTime() const {
+        return m_longestTaskTime;
+    }
+
+    void resetStats();
+
+private:
+    // ms until the deadline of a due task, negative when it passed
+    int32_t slack(const Task& p_task, uint32_t p_now) const;
+    bool isDue(Task& p_task, uint32_t p_now);
+};
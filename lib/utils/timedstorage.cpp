@@ -0,0 +1,56 @@
+#include "timedstorage.h"
+
+TimedStorage::TimedStorage(Storage& p_storage, std::function<uint32_t()> p_micros) :
+    m_storage(p_storage),
+    m_micros(p_micros),
+    m_stats() {
+}
+
+void TimedStorage::reset() {
+    for (auto& stats : m_stats) {
+        stats = Stats{0, 0, 0};
+    }
+}
+
+bool TimedStorage::exists(const char* p_name) {
+    return timed(METADATA, [&]() {
+        return m_storage.exists(p_name);
+    });
+}
+
+size_t TimedStorage::size(const char* p_name) {
+    return timed(METADATA, [&]() {
+        return m_storage.size(p_name);
+    });
+}
+
+size_t TimedStorage::read(const char* p_name, size_t p_offset, uint8_t* p_buffer, size_t p_length) {
+    return timed(READ, [&]() {
+        return m_storage.read(p_name, p_offset, p_buffer, p_length);
+    });
+}
+
+size_t TimedStorage::write(const char* p_name, const uint8_t* p_buffer, size_t p_length) {
+    return timed(WRITE, [&]() {
+        return m_storage.write(p_name, p_buffer, p_length);
+    });
+}
+
+size_t TimedStorage::append(const char* p_name, const uint8_t* p_buffer, size_t p_length) {
+    return timed(APPEND, [&]() {
+        return m_storage.append(p_name, p_buffer, p_length);
+    });
+}
+
+bool TimedStorage::remove(const char* p_name) {
+    return timed(REMOVE, [&]() {
+        return m_storage.remove(p_name);
+    });
+}
+
+void TimedStorage::flush() {
+    timed(FLUSH, [&]() {
+        m_storage.flush();
+        return true;
+    });
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <storage.h>
+
+/**
+ * Measures the latency of every operation on an other Storage
+ * p_micros is the time source, micros() on the device
+ */
+class TimedStorage : public Storage {
+public:
+    enum Operation : uint8_t {
+        // exists and size
+        METADATA,
+        READ,
+        WRITE,
+        APPEND,
+        REMOVE,
+        FLUSH,
+        OPERATIONS
+    };
+
+    struct Stats {
+        uint32_t count;
+        uint32_t total;
+        uint32_t max;
+    };
+
+private:
+    Storage& m_storage;
+    std::function<uint32_t()> m_micros;
+    Stats m_stats[OPERATIONS];
+
+public:
+    TimedStorage(Storage& p_storage, std::function<uint32_t()> p_micros);
+
+    virtual bool exists(const char* p_name);
+    virtual size_t size(const char* p_name);
+    virtual size_t read(const char* p_name, size_t p_offset, uint8_t* p_buffer, size_t p_length);
+    virtual size_t write(const char* p_name, const uint8_t* p_buffer, size_t p_length);
+    virtual size_t append(const char* p_name, const uint8_t* p_buffer, size_t p_length);
+    virtual bool remove(const char* p_name);
+    virtual void flush();
+
+    /**
+     * Number of calls, total and longest time in us of an operation
+     */
+    const Stats& stats(Operation p_operation) const {
+        return m_stats[p_operation];
+    }
+
+    void reset();
+
+private:
+    template<typename F>
+    auto timed(Operation p_operation, F p_function) -> decltype(p_function()) {
+        uint32_t start = m_micros();
+        auto result = p_function();
+        uint32_t duration = m_micros() - start;
+        Stats& stats = m_stats[p_operation];
+        stats.count++;
+        stats.total += duration;
+
+        if (duration > stats.max) {
+            stats.max = duration;
+        }
+
+        return result;
+    }
+};
@@ -7,3 +7,18 @@
 
 #include "src/test_properties.hpp"
 #include "src/test_digitalknob.hpp"
+#include "src/test_controllersettings.hpp"
+#include "src/test_propertybinary.hpp"
+#include "src/test_propertyparser.hpp"
+#include "src/test_configjournal.hpp"
+#include "src/test_persistscheduler.hpp"
+#include "src/test_storage.hpp"
+#include "src/test_taskscheduler.hpp"
+#include "src/test_frameclock.hpp"
+#include "src/test_profiler.hpp"
+#include "src/test_ringer.hpp"
+#include "src/test_edgecapture.hpp"
+#include "src/test_digitalknobbank.hpp"
+#include "src/test_gestureengine.hpp"
+#include "src/test_inputtrace.hpp"
+#include "src/test_fastpin.hpp"
@@ -0,0 +1,41 @@
+#pragma once
+#include <stdlib.h>
+#include <stdint.h>
+#include <new>
+
+// Counts all heap allocations of the test executable so tests can assert on allocations done
+#ifndef ALLOCATIONCOUNTER
+#define ALLOCATIONCOUNTER
+uint32_t allocationCounter = 0;
+
+void* operator new(std::size_t size) {
+    allocationCounter++;
+    void* p = malloc(size == 0 ? 1 : size);
+
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    free(p);
+}
+#endif
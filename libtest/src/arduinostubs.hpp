@@ -50,6 +50,10 @@ extern "C" int digitalRead(uint8_t pin) {
     return digitalReadStubbed;
 }
 
+// GPIO input and output registers
+uint32_t GPIStubbed = 0;
+uint32_t GPOStubbed = 0;
+
 int digitalWriteStubbed = 0;
 int digitalWritePinStubbed = 0;
 extern "C" void digitalWrite(uint8_t pin, uint8_t v) {
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <storage.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/**
+ * Storage in RAM that can simulate a power cut after a number of written bytes
+ * After the power cut all operations fail, files keep the bytes written up to that moment
+ * A slow flash is simulated by advancing m_micros on every write
+ */
+class MemoryStorage : public Storage {
+public:
+    std::map<std::string, std::vector<uint8_t>> m_files;
+    // Bytes that can be written before the power is cut, < 0 for unlimited
+    int64_t m_powerBudget = -1;
+    uint32_t m_bytesWritten = 0;
+    uint32_t m_bytesRead = 0;
+    // Simulated time in us, each write costs m_operationCost + m_byteCost per byte
+    uint32_t m_micros = 0;
+    uint32_t m_operationCost = 0;
+    uint32_t m_byteCost = 0;
+    // Calls of exists and size, each costs m_metadataCost
+    uint32_t m_metadataCalls = 0;
+    uint32_t m_metadataCost = 0;
+    // Calls of flush
+    uint32_t m_flushes = 0;
+
+    bool powerLost() const {
+        return m_powerBudget == 0;
+    }
+
+    /**
+     * Keep the files but restore power, as if the device rebooted
+     */
+    void reboot() {
+        m_powerBudget = -1;
+    }
+
+    virtual bool exists(const char* p_name) {
+        m_metadataCalls++;
+        m_micros += m_metadataCost;
+        return m_files.count(p_name) > 0;
+    }
+
+    virtual size_t size(const char* p_name) {
+        m_metadataCalls++;
+        m_micros += m_metadataCost;
+        auto it = m_files.find(p_name);
+        return it == m_files.end() ? 0 : it->second.size();
+    }
+
+    virtual size_t read(const char* p_name, size_t p_offset, uint8_t* p_buffer, size_t p_length) {
+        auto it = m_files.find(p_name);
+
+        if (powerLost() || it == m_files.end() || p_offset > it->second.size()) {
+            return 0;
+        }
+
+        size_t length = std::min(p_length, it->second.size() - p_offset);
+        std::copy(it->second.begin() + p_offset, it->second.begin() + p_offset + length, p_buffer);
+        m_bytesRead += length;
+        return length;
+    }
+
+    virtual size_t write(const char* p_name, const uint8_t* p_buffer, size_t p_length) {
+        if (powerLost()) {
+            return 0;
+        }
+
+        m_files[p_name].clear();
+        return append(p_name, p_buffer, p_length);
+    }
+
+    virtual size_t append(const char* p_name, const uint8_t* p_buffer, size_t p_length) {
+        if (powerLost()) {
+            return 0;
+        }
+
+        size_t length = p_length;
+        m_micros += m_operationCost + m_byteCost * p_length;
+
+        if (m_powerBudget >= 0) {
+            length = std::min<int64_t>(length, m_powerBudget);
+            m_powerBudget -= length;
+        }
+
+        auto& file = m_files[p_name];
+        file.insert(file.end(), p_buffer, p_buffer + length);
+        m_bytesWritten += length;
+        return length;
+    }
+
+    virtual bool remove(const char* p_name) {
+        if (powerLost()) {
+            return false;
+        }
+
+        return m_files.erase(p_name) > 0;
+    }
+
+    virtual void flush() {
+        m_flushes++;
+    }
+};
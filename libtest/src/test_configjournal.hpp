@@ -0,0 +1,413 @@
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <propertyutils.h>
+#include <propertybinary.h>
+#include <configjournal.h>
+#include "memorystorage.hpp"
+#include <string>
+#include <vector>
+
+typedef PropertyValue PV ;
+
+static std::vector<uint8_t> propertiesBytes(const Properties& properties) {
+    std::vector<uint8_t> buffer(propertiesBinarySize(properties));
+    serializePropertiesBinary(buffer.data(), buffer.size(), properties);
+    return buffer;
+}
+
+static void setupJournalProperties(Properties& properties) {
+    properties.put("mqttServer", PV("mqtt.home.example.org"));
+    properties.put("mqttPort", PV(1883));
+    properties.put("ringerOn", PV(true));
+    properties.put("maxRingTime", PV(5000));
+    properties.put("obsolete", PV("will be erased"));
+}
+
+/**
+ * Apply the n´th modification of the test sequence
+ */
+static void modifyJournalProperties(Properties& properties, int n) {
+    switch (n % 5) {
+        case 0:
+        case 2:
+            properties.put("ringerOn", PV(n % 10 == 0));
+            break;
+
+        case 1:
+            properties.put("maxRingTime", PV((int32_t)(1000 + n)));
+            break;
+
+        case 3:
+            properties.put("mqttServer", PV(n % 2 == 0 ? "mqtt.home.example.org" : "broker.example.org"));
+            break;
+
+        case 4:
+            if (n == 9) {
+                properties.erase("obsolete");
+            } else {
+                properties.put("ringerOn", PV(true));
+            }
+
+            break;
+    }
+}
+
+TEST_CASE("Config journal", "[journal]") {
+    MemoryStorage storage;
+    Properties properties;
+    setupJournalProperties(properties);
+    ConfigJournal journal(storage, "c.a", "c.b", "c.jnl", 256);
+
+    SECTION("Should start from an empty storage") {
+        Properties loaded;
+        REQUIRE(journal.load(loaded) == false);
+        REQUIRE(journal.save(properties));
+        ConfigJournal reboot(storage, "c.a", "c.b", "c.jnl", 256);
+        REQUIRE(reboot.load(loaded));
+        REQUIRE(propertiesBytes(loaded) == propertiesBytes(properties));
+    }
+
+    SECTION("Should only append changed properties") {
+        Properties loaded;
+        journal.load(loaded);
+        journal.compact(properties);
+        REQUIRE(storage.exists("c.jnl") == false);
+
+        properties.put("ringerOn", PV(false));
+        REQUIRE(journal.save(properties));
+        size_t journalSize = storage.size("c.jnl");
+        // header + length + record + crc
+        REQUIRE(journalSize == CONFIG_JOURNAL_HEADER_SIZE + 2 + propertyRecordSize("ringerOn", PV(false)) + 2);
+
+        REQUIRE(journal.save(properties));
+        REQUIRE(storage.size("c.jnl") == journalSize);
+
+        properties.put("ringerOn", PV(true));
+        REQUIRE(journal.save(properties));
+        ConfigJournal reboot(storage, "c.a", "c.b", "c.jnl", 256);
+        REQUIRE(reboot.load(loaded));
+        REQUIRE((bool)loaded.get("ringerOn") == true);
+        REQUIRE(propertiesBytes(loaded) == propertiesBytes(properties));
+    }
+
+    SECTION("Should compact when the journal grows to large") {
+        Properties loaded;
+        journal.load(loaded);
+
+        for (int i = 0; i < 100; i++) {
+            properties.put("ringerOn", PV(i % 2 == 0));
+            REQUIRE(journal.save(properties));
+            REQUIRE(storage.size("c.jnl") <= 256);
+        }
+
+        REQUIRE(journal.compactions() > 0);
+        REQUIRE(journal.compactions() < 10);
+        // A full rewrite per toggle would have written 100 snapshots
+        REQUIRE(journal.bytesWritten() < 100 * propertiesBinarySize(properties) / 3);
+        REQUIRE(journal.writeAmplification() > 1.0f);
+
+        ConfigJournal reboot(storage, "c.a", "c.b", "c.jnl", 256);
+        REQUIRE(reboot.load(loaded));
+        REQUIRE(propertiesBytes(loaded) == propertiesBytes(properties));
+    }
+
+    SECTION("Should compact when a property is erased") {
+        Properties loaded;
+        journal.load(loaded);
+        journal.save(properties);
+        properties.erase("obsolete");
+        REQUIRE(journal.save(properties));
+        REQUIRE(journal.compactions() == 1);
+
+        Properties reloaded;
+        ConfigJournal reboot(storage, "c.a", "c.b", "c.jnl", 256);
+        REQUIRE(reboot.load(reloaded));
+        REQUIRE(reloaded.contains("obsolete") == false);
+    }
+
+    SECTION("Should ignore a torn record at the end") {
+        Properties loaded;
+        journal.load(loaded);
+        journal.compact(properties);
+        properties.put("ringerOn", PV(false));
+        journal.save(properties);
+        uint8_t garbage[] = {20, 0, 'B', 8, 'r', 'i'};
+        storage.append("c.jnl", garbage, sizeof(garbage));
+
+        ConfigJournal reboot(storage, "c.a", "c.b", "c.jnl", 256);
+        Properties reloaded;
+        REQUIRE(reboot.load(reloaded));
+        REQUIRE((bool)reloaded.get("ringerOn") == false);
+
+        // Next save cannot append after the torn record
+        reloaded.put("maxRingTime", PV(10));
+        REQUIRE(reboot.save(reloaded));
+        REQUIRE(reboot.compactions() == 1);
+    }
+}
+
+TEST_CASE("Config journal slots", "[journal]") {
+    MemoryStorage storage;
+    Properties properties;
+    setupJournalProperties(properties);
+    ConfigJournal journal(storage, "c.a", "c.b", "c.jnl", 256);
+
+    SECTION("Should alternate slots on compaction") {
+        REQUIRE(journal.compact(properties));
+        REQUIRE(journal.generation() == 1);
+        uint8_t first = journal.activeSlot();
+        properties.put("ringerOn", PV(false));
+        REQUIRE(journal.compact(properties));
+        REQUIRE(journal.generation() == 2);
+        REQUIRE(journal.activeSlot() != first);
+        REQUIRE(storage.exists("c.a"));
+        REQUIRE(storage.exists("c.b"));
+
+        Properties loaded;
+        ConfigJournal reboot(storage, "c.a", "c.b", "c.jnl", 256);
+        REQUIRE(reboot.load(loaded));
+        REQUIRE(reboot.generation() == 2);
+        REQUIRE((bool)loaded.get("ringerOn") == false);
+    }
+
+    SECTION("Should only parse the newest slot") {
+        journal.compact(properties);
+        properties.put("ringerOn", PV(false));
+        journal.compact(properties);
+        const char* newest = journal.activeSlot() == 0 ? "c.a" : "c.b";
+
+        storage.m_bytesRead = 0;
+        Properties loaded;
+        ConfigJournal reboot(storage, "c.a", "c.b", "c.jnl", 256);
+        REQUIRE(reboot.load(loaded));
+        REQUIRE(storage.m_bytesRead == storage.size(newest) + 2 * (CONFIG_SLOT_HEADER_SIZE + PROPERTIES_BINARY_HEADER_SIZE));
+    }
+
+    SECTION("Should fallback to the previous slot when the newest is torn") {
+        journal.compact(properties);
+        properties.put("ringerOn", PV(false));
+        journal.compact(properties);
+        const char* newest = journal.activeSlot() == 0 ? "c.a" : "c.b";
+        storage.m_files[newest].pop_back();
+
+        Properties loaded;
+        ConfigJournal reboot(storage, "c.a", "c.b", "c.jnl", 256);
+        REQUIRE(reboot.load(loaded));
+        REQUIRE(reboot.generation() == 1);
+        REQUIRE((bool)loaded.get("ringerOn") == true);
+
+        // The torn slot is the one that gets written next
+        loaded.put("maxRingTime", PV(10));
+        REQUIRE(reboot.compact(loaded));
+        REQUIRE(reboot.generation() == 2);
+        REQUIRE(storage.m_files[newest].size() == CONFIG_SLOT_HEADER_SIZE + propertiesBinarySize(loaded));
+    }
+
+    SECTION("Should reject a slot with a corrupt header") {
+        journal.compact(properties);
+        const char* newest = journal.activeSlot() == 0 ? "c.a" : "c.b";
+        storage.m_files[newest][5] ^= 0x01;
+        storage.m_files[journal.activeSlot() == 0 ? "c.b" : "c.a"] = storage.m_files[newest];
+
+        Properties loaded;
+        ConfigJournal reboot(storage, "c.a", "c.b", "c.jnl", 256);
+        REQUIRE(reboot.load(loaded) == false);
+        REQUIRE(loaded.size() == 0);
+    }
+}
+
+TEST_CASE("Config journal incremental save", "[journal]") {
+    MemoryStorage storage;
+    // Roughly a LittleFS append on a ESP8266, open and close dominate
+    storage.m_operationCost = 400;
+    storage.m_byteCost = 20;
+    const uint32_t budget = 2000;
+    auto clock = [&storage]() {
+        return storage.m_micros;
+    };
+    Properties properties;
+    setupJournalProperties(properties);
+    ConfigJournal journal(storage, "c.a", "c.b", "c.jnl", 96);
+    Properties loaded;
+    journal.load(loaded);
+
+    SECTION("Should write nothing until stepped") {
+        REQUIRE(journal.beginSave(properties));
+        REQUIRE(journal.isSaving());
+        REQUIRE(storage.m_bytesWritten == 0);
+        REQUIRE(journal.beginSave(properties) == false);
+        REQUIRE(journal.finishSave());
+        REQUIRE(journal.isSaving() == false);
+    }
+
+    SECTION("Should stay within the budget of every frame") {
+        uint32_t frames = 0;
+
+        for (int n = 0; n < 30; n++) {
+            modifyJournalProperties(properties, n);
+            REQUIRE(journal.beginSave(properties));
+
+            bool done = false;
+
+            while (!done) {
+                uint32_t start = storage.m_micros;
+                done = journal.saveStep(budget, clock);
+                REQUIRE(storage.m_micros - start <= budget);
+                frames++;
+            }
+
+            REQUIRE(journal.lastSaveOk());
+        }
+
+        REQUIRE(journal.compactions() > 2);
+        // More than a minimal chunk per frame
+        REQUIRE(frames < storage.m_bytesWritten / CONFIG_JOURNAL_MIN_CHUNK);
+
+        Properties reloaded;
+        ConfigJournal reboot(storage, "c.a", "c.b", "c.jnl", 96);
+        REQUIRE(reboot.load(reloaded));
+        REQUIRE(propertiesBytes(reloaded) == propertiesBytes(properties));
+    }
+
+    SECTION("Should stop at the budget while no chunk took measurable time") {
+        // Chunks never take a tick of this clock, but time does pass between them
+        uint32_t reads = 0;
+        uint32_t now = 0;
+        auto coarseClock = [&reads, &now]() {
+            if (++reads % 3 == 0) {
+                now += 600;
+            }
+
+            return now;
+        };
+
+        storage.m_operationCost = 0;
+        storage.m_byteCost = 0;
+        properties.put("mqttServer", PV("a.much.longer.broker.name.example.org"));
+        REQUIRE(journal.beginSave(properties));
+
+        uint32_t calls = 1;
+
+        while (!journal.saveStep(budget, coarseClock)) {
+            calls++;
+        }
+
+        REQUIRE(calls > 1);
+        REQUIRE(journal.lastSaveOk());
+    }
+
+    SECTION("Should flush once per step instead of once per chunk") {
+        REQUIRE(journal.save(properties));
+        properties.put("mqttServer", PV("a.much.longer.broker.name.example.org"));
+        REQUIRE(journal.beginSave(properties));
+        bool done = false;
+        uint32_t frames = 0;
+
+        while (!done) {
+            uint32_t flushes = storage.m_flushes;
+            done = journal.saveStep(budget, clock);
+            REQUIRE(storage.m_flushes == flushes + 1);
+            frames++;
+        }
+
+        REQUIRE(frames > 1);
+
+        properties.put("mqttServer", PV("broker"));
+        REQUIRE(journal.beginSave(properties));
+        uint32_t flushes = storage.m_flushes;
+
+        while (!journal.saveStep((size_t)1)) {
+            REQUIRE(storage.m_flushes == flushes);
+        }
+
+        REQUIRE(storage.m_flushes == flushes + 1);
+        REQUIRE(journal.lastSaveOk());
+    }
+
+    SECTION("Should keep the previous state until the last chunk is written") {
+        REQUIRE(journal.save(properties));
+        std::vector<uint8_t> before = propertiesBytes(properties);
+        properties.put("mqttServer", PV("a.much.longer.broker.name.example.org"));
+        REQUIRE(journal.beginSave(properties));
+
+        while (!journal.saveStep((size_t)1)) {
+            Properties reloaded;
+            ConfigJournal reboot(storage, "c.a", "c.b", "c.jnl", 96);
+            reboot.load(reloaded);
+            REQUIRE(propertiesBytes(reloaded) == before);
+        }
+
+        Properties reloaded;
+        ConfigJournal reboot(storage, "c.a", "c.b", "c.jnl", 96);
+        reboot.load(reloaded);
+        REQUIRE(propertiesBytes(reloaded) == propertiesBytes(properties));
+    }
+}
+
+TEST_CASE("Config journal crash consistency", "[journal]") {
+    const int modifications = 30;
+    // 0 writes a slot on every save
+    const size_t compactSizes[] = {0, 96};
+
+    for (size_t compactSize : compactSizes) {
+        // Record all states and the bytes a complete run writes
+        std::vector<std::vector<uint8_t>> states;
+        uint32_t totalBytes;
+        {
+            MemoryStorage storage;
+            ConfigJournal journal(storage, "c.a", "c.b", "c.jnl", compactSize);
+            Properties properties;
+            states.push_back(propertiesBytes(properties));
+            setupJournalProperties(properties);
+            REQUIRE(journal.save(properties));
+            states.push_back(propertiesBytes(properties));
+
+            for (int n = 0; n < modifications; n++) {
+                modifyJournalProperties(properties, n);
+                REQUIRE(journal.save(properties));
+                states.push_back(propertiesBytes(properties));
+            }
+
+            REQUIRE(journal.compactions() > 2);
+            totalBytes = storage.m_bytesWritten;
+        }
+
+        // Cut the power after every possible number of bytes written
+        for (uint32_t budget = 0; budget <= totalBytes; budget++) {
+            MemoryStorage storage;
+            storage.m_powerBudget = budget;
+            ConfigJournal journal(storage, "c.a", "c.b", "c.jnl", compactSize);
+            Properties properties;
+            size_t completed = 0;
+
+            setupJournalProperties(properties);
+
+            if (journal.save(properties)) {
+                completed++;
+
+                for (int n = 0; n < modifications && !storage.powerLost(); n++) {
+                    modifyJournalProperties(properties, n);
+
+                    if (!journal.save(properties)) {
+                        break;
+                    }
+
+                    completed++;
+                }
+            }
+
+            storage.reboot();
+            Properties loaded;
+            ConfigJournal reboot(storage, "c.a", "c.b", "c.jnl", compactSize);
+            reboot.load(loaded);
+            std::vector<uint8_t> loadedBytes = propertiesBytes(loaded);
+
+            // Must be the last completed state or the one that was being written
+            bool consistent = loadedBytes == states[completed] ||
+                              (completed + 1 < states.size() && loadedBytes == states[completed + 1]);
+            INFO("Compact size " << compactSize << " power cut after " << budget << " bytes, " << completed << " saves completed");
+            REQUIRE(consistent);
+        }
+    }
+}
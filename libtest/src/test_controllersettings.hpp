@@ -0,0 +1,235 @@
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <propertyutils.h>
+#include <controllersettings.h>
+
+using Catch::Matchers::Equals;
+
+typedef PropertyValue PV ;
+
+static void setupControllerProperties(Properties& properties) {
+    properties.put(KEY_MQTT_CLIENT_ID, PV("DOORBELL00C0FFEE"));
+    properties.put(KEY_MQTT_BASE_TOPIC, PV("DOORBELL"));
+    properties.put(KEY_MQTT_SERVER, PV("192.168.1.10"));
+    properties.put(KEY_MQTT_USERNAME, PV("user"));
+    properties.put(KEY_MQTT_PASSWORD, PV("secret"));
+    properties.put(KEY_MQTT_PORT, PV(1883));
+    properties.put(KEY_RINGER_ON, PV(true));
+    properties.put(KEY_MAX_RING_TIME, PV(5000));
+    properties.put(KEY_FRAME_CATCH_UP, PV(2));
+    properties.put(KEY_RING_ON_TIME, PV(400));
+    properties.put(KEY_RING_OFF_TIME, PV(200));
+    properties.put(KEY_DEBOUNCE_MIN_ALPHA, PV(120));
+    properties.put(KEY_DEBOUNCE_MAX_ALPHA, PV(300));
+    properties.put(KEY_DEBOUNCE_MIN_TIME, PV(4000));
+    properties.put(KEY_DEBOUNCE_MAX_TIME, PV(25000));
+}
+
+TEST_CASE("Controller settings snapshot", "[controllersettings]") {
+    Properties properties;
+    ControllerSettings settings;
+    setupControllerProperties(properties);
+    loadControllerSettings(settings, properties);
+
+    SECTION("Should copy all values") {
+        REQUIRE(settings.ringerOn == true);
+        REQUIRE(settings.maxRingTime == 5000);
+        REQUIRE(settings.frameCatchUp == 2);
+        REQUIRE(settings.ringOnTime == 400);
+        REQUIRE(settings.ringOffTime == 200);
+        REQUIRE(settings.debounceMinAlpha == 120);
+        REQUIRE(settings.debounceMaxAlpha == 300);
+        REQUIRE(settings.debounceMinTime == 4000);
+        REQUIRE(settings.debounceMaxTime == 25000);
+        REQUIRE(settings.mqttPort == 1883);
+        REQUIRE(settings.hasMqttServer == true);
+        REQUIRE_THAT(settings.mqttServer, Equals("192.168.1.10"));
+        REQUIRE_THAT(settings.mqttUsername, Equals("user"));
+        REQUIRE_THAT(settings.mqttPassword, Equals("secret"));
+    }
+
+    SECTION("Should derive topics") {
+        REQUIRE_THAT(settings.mqttStatusTopic, Equals("DOORBELL/status"));
+        REQUIRE_THAT(settings.mqttLastWillTopic, Equals("DOORBELL00C0FFEE/lastwill"));
+        REQUIRE_THAT(settings.mqttSubscriberTopic, Equals("DOORBELL00C0FFEE/+"));
+    }
+
+    SECTION("Should only change after a reload") {
+        properties.put(KEY_RINGER_ON, PV(false));
+        REQUIRE(settings.ringerOn == true);
+        loadControllerSettings(settings, properties);
+        REQUIRE(settings.ringerOn == false);
+    }
+
+    SECTION("Should truncate long strings and handle missing values") {
+        Properties empty;
+        empty.put(KEY_MQTT_SERVER, PV(std::string(100, 'x')));
+        loadControllerSettings(settings, empty);
+        REQUIRE(std::strlen(settings.mqttServer) == sizeof(settings.mqttServer) - 1);
+        REQUIRE_THAT(settings.mqttUsername, Equals(""));
+        REQUIRE(settings.mqttPort == 0);
+    }
+}
+
+TEST_CASE("Controller config schema", "[controllersettings]") {
+    Properties properties;
+
+    SECTION("Should have unique keys") {
+        for (const ConfigSchemaEntry& entry : CONFIG_SCHEMA) {
+            for (const ConfigSchemaEntry& other : CONFIG_SCHEMA) {
+                REQUIRE((&entry == &other || entry.key.hash() != other.key.hash()));
+            }
+
+            REQUIRE(findConfigSchema(entry.key.name()) != nullptr);
+        }
+    }
+
+    SECTION("Should apply defaults once") {
+        REQUIRE(applyConfigDefaults(properties, "DOORBELL00C0FFEE"));
+        REQUIRE(properties.size() == sizeof(CONFIG_SCHEMA) / sizeof(CONFIG_SCHEMA[0]));
+        REQUIRE_THAT((const char*)properties.get(KEY_MQTT_CLIENT_ID), Equals("DOORBELL00C0FFEE"));
+        REQUIRE_THAT((const char*)properties.get(KEY_MQTT_BASE_TOPIC), Equals("DOORBELL"));
+        REQUIRE((int32_t)properties.get(KEY_MQTT_PORT) == 1883);
+        REQUIRE(properties.get(KEY_RINGER_ON).type() == PropertyValue::BOOL);
+        REQUIRE((bool)properties.get(KEY_RINGER_ON) == true);
+        REQUIRE((int32_t)properties.get(KEY_MAX_RING_TIME) == 5000);
+        REQUIRE((int32_t)properties.get(KEY_FRAME_CATCH_UP) == 1);
+
+        REQUIRE(applyConfigDefaults(properties, "OTHER") == false);
+        REQUIRE_THAT((const char*)properties.get(KEY_MQTT_CLIENT_ID), Equals("DOORBELL00C0FFEE"));
+    }
+
+    SECTION("Should keep existing values") {
+        properties.put(KEY_MQTT_PORT, PV(8883));
+        REQUIRE(applyConfigDefaults(properties, "DOORBELL00C0FFEE"));
+        REQUIRE((int32_t)properties.get(KEY_MQTT_PORT) == 8883);
+    }
+
+    SECTION("Should validate values") {
+        applyConfigDefaults(properties, "DOORBELL00C0FFEE");
+        REQUIRE(putConfigValue(properties, KEY_MQTT_PORT, PV(8883)) == ConfigError::NONE);
+        REQUIRE(putConfigValue(properties, KEY_MQTT_PORT, PV(0)) == ConfigError::OUT_OF_RANGE);
+        REQUIRE(putConfigValue(properties, KEY_MQTT_PORT, PV(70000)) == ConfigError::OUT_OF_RANGE);
+        REQUIRE(putConfigValue(properties, KEY_MQTT_PORT, PV("1883")) == ConfigError::WRONG_TYPE);
+        REQUIRE((int32_t)properties.get(KEY_MQTT_PORT) == 8883);
+
+        REQUIRE(putConfigValue(properties, KEY_MQTT_SERVER, PV(std::string(63, 'x'))) == ConfigError::NONE);
+        REQUIRE(putConfigValue(properties, KEY_MQTT_SERVER, PV(std::string(64, 'x'))) == ConfigError::OUT_OF_RANGE);
+        REQUIRE(putConfigValue(properties, KEY_MQTT_CLIENT_ID, PV("")) == ConfigError::OUT_OF_RANGE);
+        REQUIRE(putConfigValue(properties, KEY_RINGER_ON, PV(false)) == ConfigError::NONE);
+        REQUIRE(putConfigValue(properties, PropertyKey("unknown"), PV(1)) == ConfigError::UNKNOWN_KEY);
+        REQUIRE(properties.contains("unknown") == false);
+    }
+
+    SECTION("Should not persist derived values") {
+        applyConfigDefaults(properties, "DOORBELL00C0FFEE");
+        properties.put("custom", PV(1));
+        Properties persistent;
+        persistentConfig(persistent, properties);
+        REQUIRE(persistent.contains(KEY_MQTT_LAST_WILL_TOPIC) == false);
+        REQUIRE(persistent.contains(KEY_MQTT_CLIENT_ID));
+        REQUIRE(persistent.contains("custom"));
+    }
+}
+
+TEST_CASE("Controller config listeners", "[controllersettings]") {
+    Properties properties;
+    ConfigListeners listeners;
+    applyConfigDefaults(properties, "DOORBELL00C0FFEE");
+    properties.clearDirty();
+    int persisted = 0;
+    int published = 0;
+    int reconnected = 0;
+    int ringerOn = -1;
+    listeners.onGroup(CONFIG_PERSIST, [&persisted]() {
+        persisted++;
+    });
+    listeners.onGroup(CONFIG_PUBLISH, [&published]() {
+        published++;
+    });
+    listeners.onGroup(CONFIG_RECONNECT, [&reconnected]() {
+        reconnected++;
+    });
+    listeners.onKey(KEY_RINGER_ON, [&ringerOn](const PropertyValue & p_value) {
+        ringerOn = (bool)p_value;
+    });
+
+    SECTION("Should not call listeners without changes") {
+        properties.put(KEY_RINGER_ON, PV(true));
+        REQUIRE(listeners.dispatch(properties) == 0);
+        REQUIRE(persisted + published + reconnected == 0);
+        REQUIRE(ringerOn == -1);
+    }
+
+    SECTION("Should publish and persist ringerOn without reconnect") {
+        properties.put(KEY_RINGER_ON, PV(false));
+        properties.put(KEY_RINGER_ON, PV(true));
+        properties.put(KEY_RINGER_ON, PV(false));
+        REQUIRE(listeners.dispatch(properties) == (CONFIG_PERSIST | CONFIG_PUBLISH));
+        REQUIRE(persisted == 1);
+        REQUIRE(published == 1);
+        REQUIRE(reconnected == 0);
+        REQUIRE(ringerOn == 0);
+        REQUIRE(properties.isDirty() == false);
+    }
+
+    SECTION("Should reconnect once for several MQTT keys") {
+        properties.put(KEY_MQTT_SERVER, PV("192.168.1.10"));
+        properties.put(KEY_MQTT_PORT, PV(8883));
+        listeners.dispatch(properties);
+        REQUIRE(reconnected == 1);
+        REQUIRE(persisted == 1);
+        REQUIRE(published == 0);
+        REQUIRE(ringerOn == -1);
+    }
+
+    SECTION("Should only reconnect for derived keys") {
+        properties.put(KEY_MQTT_LAST_WILL_TOPIC, PV("other/lastwill"));
+        REQUIRE(listeners.dispatch(properties) == CONFIG_RECONNECT);
+        REQUIRE(persisted == 0);
+    }
+
+    SECTION("Should persist erased keys") {
+        properties.erase("maxRingTime");
+        REQUIRE(listeners.dispatch(properties) == CONFIG_PERSIST);
+        REQUIRE(persisted == 1);
+    }
+}
+
+TEST_CASE("Controller settings per frame cost", "[!benchmark][controllersettings]") {
+    Properties properties;
+    ControllerSettings settings;
+    setupControllerProperties(properties);
+    loadControllerSettings(settings, properties);
+    uint32_t bellStartTime = 0;
+    volatile bool ring = false;
+
+    // The ringer decision of loop() done 1000 times
+    BENCHMARK("Properties lookup by std::string") {
+        for (uint32_t now = 0; now < 1000; now++) {
+            ring = properties.get("ringerOn") &&
+                   (now - bellStartTime < (uint32_t)properties.get("maxRingTime").asLong());
+        }
+    }
+
+    BENCHMARK("Properties lookup by PropertyKey") {
+        for (uint32_t now = 0; now < 1000; now++) {
+            ring = properties.get(KEY_RINGER_ON) &&
+                   (now - bellStartTime < (uint32_t)properties.get(KEY_MAX_RING_TIME).asLong());
+        }
+    }
+
+    BENCHMARK("ControllerSettings snapshot") {
+        for (uint32_t now = 0; now < 1000; now++) {
+            ring = settings.ringerOn &&
+                   (now - bellStartTime < settings.maxRingTime);
+        }
+    }
+
+    BENCHMARK("Rebuild ControllerSettings snapshot") {
+        loadControllerSettings(settings, properties);
+    }
+
+    REQUIRE(ring == true);
+}
@@ -180,4 +180,211 @@ SCENARIO("Digital Knob", "[DigitalKnob]") {
             REQUIRE(dn->isEdgeDown() == false); // Should stay reset
         }
     }
-}
\ No newline at end of file
+}
+TEST_CASE("Digital Knob at different tick rates", "[DigitalKnob]") {
+    struct Detected {
+        bool single;
+        bool isDouble;
+        bool isLong;
+        // ms from the press until edge up
+        uint32_t edgeUp;
+    };
+
+    // Press the button for each duration in p_pattern, pressed and released alternating, starting with pressed
+    auto run = [](DigitalKnob & p_knob, uint16_t p_tickPeriod, std::initializer_list<uint16_t> p_pattern) {
+        Detected detected{false, false, false, 0};
+        bool pressed = true;
+        uint32_t time = 0;
+        bool edgeSeen = false;
+
+        for (uint16_t duration : p_pattern) {
+            for (uint32_t t = 0; t < duration; t += p_tickPeriod) {
+                digitalReadStubbed = pressed;
+                p_knob.handle();
+                time += p_tickPeriod;
+
+                if (p_knob.isEdgeUp() && !edgeSeen) {
+                    detected.edgeUp = time;
+                    edgeSeen = true;
+                }
+
+                detected.single = detected.single || p_knob.isSingle();
+                detected.isDouble = detected.isDouble || p_knob.isDouble();
+                detected.isLong = detected.isLong || p_knob.isLong();
+            }
+
+            pressed = !pressed;
+        }
+
+        digitalReadStubbed = false;
+        return detected;
+    };
+
+    for (uint16_t tickPeriod : {20, 10, 5, 1}) {
+        for (bool history64 : {false, true}) {
+            DYNAMIC_SECTION("Tick " << tickPeriod << "ms, " << (history64 ? 64 : 32) << " bit history") {
+                DigitalKnob knob(1, false, 110, tickPeriod, history64);
+                digitalReadStubbed = false;
+
+                Detected single = run(knob, tickPeriod, {240, 700});
+                REQUIRE(single.single);
+                REQUIRE_FALSE(single.isDouble);
+                REQUIRE_FALSE(single.isLong);
+
+                Detected twice = run(knob, tickPeriod, {160, 220, 160, 700});
+                REQUIRE(twice.isDouble);
+                REQUIRE_FALSE(twice.isLong);
+
+                Detected hold = run(knob, tickPeriod, {1000, 700});
+                REQUIRE(hold.isLong);
+                REQUIRE_FALSE(hold.single);
+
+                // Same filter time constant at every rate, the threshold is crossed after about 10ms
+                REQUIRE(hold.edgeUp >= 10);
+                REQUIRE(hold.edgeUp <= 20);
+            }
+        }
+    }
+}
+
+TEST_CASE("Digital Knob press events", "[DigitalKnob]") {
+    DigitalKnob knob(1, false, 100);
+    millisStubbed = 1000;
+
+    // Press the button for each duration in p_pattern, pressed and released alternating, starting with pressed
+    auto run = [&](std::initializer_list<uint16_t> p_pattern) {
+        bool pressed = true;
+
+        for (uint16_t duration : p_pattern) {
+            for (uint32_t t = 0; t < duration; t += 20) {
+                millisStubbed += 20;
+                knob.handleDebounced(pressed);
+            }
+
+            pressed = !pressed;
+        }
+    };
+
+    PressEvent events[DIGITAL_INPUT_EVENTS];
+
+    SECTION("Should time a single click") {
+        run({240, 700});
+        REQUIRE(knob.events(events, DIGITAL_INPUT_EVENTS) == 3);
+        REQUIRE(events[0].m_type == PressEvent::EDGE_UP);
+        REQUIRE(events[0].m_start == 1020);
+        REQUIRE(events[1].m_type == PressEvent::EDGE_DOWN);
+        REQUIRE(events[1].m_start == 1020);
+        REQUIRE(events[1].m_duration == 240);
+        REQUIRE(events[2].m_type == PressEvent::SINGLE);
+        REQUIRE(events[2].m_duration == 240);
+        REQUIRE(events[2].m_sequence == 2);
+        REQUIRE(knob.events(events, DIGITAL_INPUT_EVENTS) == 0);
+    }
+
+    SECTION("Should time a double click from the first press") {
+        run({160, 220, 160, 700});
+        REQUIRE(knob.events(events, DIGITAL_INPUT_EVENTS) == 5);
+        REQUIRE(events[4].m_type == PressEvent::DOUBLE);
+        REQUIRE(events[4].m_start == 1020);
+        REQUIRE(events[4].m_duration == 160 + 220 + 160);
+    }
+
+    SECTION("Should report a long press once") {
+        run({1500, 700});
+        REQUIRE(knob.events(events, DIGITAL_INPUT_EVENTS) == 3);
+        REQUIRE(events[1].m_type == PressEvent::LONG);
+        REQUIRE(events[1].m_duration >= 400);
+        REQUIRE(events[2].m_type == PressEvent::EDGE_DOWN);
+        REQUIRE(events[2].m_duration == 1500);
+    }
+
+    SECTION("Should keep events between reads and drain in batches") {
+        run({240, 700, 240, 700});
+        REQUIRE(knob.events(events, 4) == 4);
+        REQUIRE(events[3].m_type == PressEvent::EDGE_UP);
+        REQUIRE(knob.events(events, 4) == 2);
+        REQUIRE(events[0].m_sequence == 4);
+        REQUIRE(events[1].m_type == PressEvent::SINGLE);
+        REQUIRE(knob.lostEvents() == 0);
+    }
+
+    SECTION("Should overwrite the oldest events when full") {
+        for (int i = 0; i < 4; i++) {
+            run({240, 700});
+        }
+
+        REQUIRE(knob.events(events, DIGITAL_INPUT_EVENTS) == DIGITAL_INPUT_EVENTS);
+        REQUIRE(knob.lostEvents() == 4);
+        REQUIRE(events[0].m_sequence == 4);
+        REQUIRE(events[DIGITAL_INPUT_EVENTS - 1].m_sequence == 11);
+    }
+}
+
+TEST_CASE("Digital Knob adaptive filter", "[DigitalKnob]") {
+    DigitalKnob knob(1, false, 110);
+    millisStubbed = 0;
+    digitalReadStubbed = false;
+
+    // p_seconds of idle line with a spike of a single sample every p_spikeTicks ticks, 0 for a clean line
+    auto run = [&knob](uint32_t p_seconds, uint32_t p_spikeTicks) {
+        for (uint32_t i = 1; i <= p_seconds * 50; i++) {
+            digitalReadStubbed = p_spikeTicks > 0 && (i + p_spikeTicks / 2) % p_spikeTicks == 0;
+            millisStubbed += 20;
+            knob.handle();
+        }
+
+        digitalReadStubbed = false;
+    };
+
+    SECTION("Should count spikes that pass the filter as short presses") {
+        run(10, 25);
+        REQUIRE(knob.shortPresses() == 20);
+        REQUIRE(knob.transitions() == 40);
+        REQUIRE(knob.glitches() == 0);
+        REQUIRE(knob.alpha() == 110);
+    }
+
+    SECTION("Should count spikes that are filtered as glitches") {
+        DigitalKnob filtered(1, false, 300);
+        digitalReadStubbed = true;
+        filtered.handle();
+        digitalReadStubbed = false;
+        filtered.handle();
+        filtered.handle();
+        REQUIRE(filtered.glitches() == 1);
+        REQUIRE(filtered.transitions() == 0);
+    }
+
+    SECTION("Should raise alpha on a noisy line until the noise is filtered") {
+        knob.adaptiveAlpha(110, 400);
+        run(10, 25);
+        REQUIRE(knob.alpha() == 138);
+        run(60, 25);
+        int16_t alpha = knob.alpha();
+        REQUIRE(alpha > 138);
+        REQUIRE(alpha <= 400);
+
+        uint32_t shortPresses = knob.shortPresses();
+        run(20, 25);
+        REQUIRE(knob.shortPresses() == shortPresses);
+        REQUIRE(knob.alpha() == alpha);
+        REQUIRE(knob.glitches() > 0);
+    }
+
+    SECTION("Should lower alpha on a clean line") {
+        knob.adaptiveAlpha(110, 400);
+        run(60, 25);
+        REQUIRE(knob.alpha() > 110);
+        run(120, 0);
+        REQUIRE(knob.alpha() == 110);
+    }
+
+    SECTION("Should keep alpha within the bounds") {
+        knob.adaptiveAlpha(120, 150);
+        REQUIRE(knob.alpha() == 120);
+        run(60, 25);
+        REQUIRE(knob.alpha() == 150);
+        knob.adaptiveAlpha(110, 110);
+        REQUIRE(knob.alpha() == 110);
+    }
+}
@@ -0,0 +1,108 @@
+#include <catch2/catch.hpp>
+
+#include "arduinostubs.hpp"
+
+#include <digitalknob.h>
+#include <digitalknobbank.h>
+
+TEST_CASE("Digital knob bank", "[DigitalKnobBank]") {
+    DigitalKnobBank bank({4, 12, 13}, false);
+    const uint32_t front = 1UL << 4;
+    const uint32_t gate = 1UL << 13;
+
+    auto ticks = [&bank](uint32_t p_inputs, uint8_t p_count) {
+        for (uint8_t i = 0; i < p_count; i++) {
+            bank.handle(p_inputs);
+        }
+    };
+
+    SECTION("Should change state after 4 equal samples") {
+        ticks(front, 3);
+        REQUIRE(bank.current() == 0);
+        bank.handle(front);
+        REQUIRE(bank.current() == front);
+        REQUIRE(bank.edgeUp() == front);
+        bank.handle(front);
+        REQUIRE(bank.edgeUp() == 0);
+    }
+
+    SECTION("Should ignore bounces and pins that are not in the bank") {
+        for (uint8_t i = 0; i < 20; i++) {
+            bank.handle(i % 3 == 0 ? 0 : front | 1);
+        }
+
+        REQUIRE(bank.current() == 0);
+    }
+
+    SECTION("Should detect clicks per button") {
+        ticks(gate, 8);
+        ticks(0, 40);
+        REQUIRE(bank[2].isSingle());
+        REQUIRE_FALSE(bank[0].isSingle());
+
+        ticks(front | gate, 30);
+        REQUIRE(bank[0].isLong());
+        REQUIRE(bank[2].isLong());
+        ticks(0, 4);
+        REQUIRE(bank.edgeDown() == (front | gate));
+    }
+
+    SECTION("Should invert for pull-up wiring") {
+        DigitalKnobBank inverted({4}, true);
+
+        for (uint8_t i = 0; i < 4; i++) {
+            inverted.handle(0xFFFFFFFF & ~front);
+        }
+
+        REQUIRE(inverted.current() == front);
+    }
+
+    SECTION("Should read the GPIO input register") {
+        GPIStubbed = front;
+        bank.init();
+
+        for (uint8_t i = 0; i < 4; i++) {
+            bank.handle();
+        }
+
+        REQUIRE(bank.current() == front);
+        GPIStubbed = 0;
+    }
+}
+
+TEST_CASE("Digital knob bank cost per tick", "[!benchmark][DigitalKnobBank]") {
+    const uint32_t TICKS = 100000;
+    DigitalKnobBank bank({0, 1, 2, 3, 4, 5, 12, 13, 14, 15}, false);
+    std::vector<DigitalKnob> knobs;
+
+    for (uint8_t pin : {0, 1, 2, 3, 4, 5, 12, 13, 14, 15}) {
+        knobs.emplace_back(pin, false, 100);
+    }
+
+    // One button pressed for 10 ticks every 100 ticks, the separate knobs share the stubbed pin so they all see it
+    BENCHMARK("10 separate DigitalKnob, 100000 ticks") {
+        for (uint32_t i = 0; i < TICKS; i++) {
+            digitalReadStubbed = i % 100 < 10;
+
+            for (auto& knob : knobs) {
+                knob.handle();
+            }
+        }
+    }
+
+    BENCHMARK("DigitalKnobBank of 10, 100000 ticks") {
+        for (uint32_t i = 0; i < TICKS; i++) {
+            bank.handle(i % 100 < 10 ? 1 << 4 : 0);
+        }
+    }
+
+    DigitalKnobBank single({4}, false);
+
+    BENCHMARK("DigitalKnobBank of 1, 100000 ticks") {
+        for (uint32_t i = 0; i < TICKS; i++) {
+            single.handle(i % 100 < 10 ? 1 << 4 : 0);
+        }
+    }
+
+    digitalReadStubbed = 0;
+}
@@ -0,0 +1,223 @@
+#include <catch2/catch.hpp>
+
+#include <edgecapture.h>
+#include <digitalknob.h>
+
+TEST_CASE("Edge capture", "[edgecapture]") {
+    EdgeCapture capture(false, 5000);
+
+    // Contact bounce, p_count edges 100us apart ending at p_level
+    auto bounce = [&capture](uint32_t p_time, bool p_level, uint8_t p_count) {
+        for (uint8_t i = 0; i < p_count; i++) {
+            capture.capture(i % 2 == p_count % 2 ? !p_level : p_level, p_time + i * 100);
+        }
+    };
+
+    SECTION("Should timestamp a press with its first edge") {
+        bounce(10000, true, 5);
+        REQUIRE(capture.update(12000) == false);
+        REQUIRE(capture.update(15399) == false);
+        REQUIRE(capture.update(15400) == true);
+        REQUIRE(capture.lastPress() == 10000);
+        REQUIRE(capture.edges() == 5);
+        REQUIRE(capture.glitches() == 0);
+
+        bounce(100000, false, 3);
+        REQUIRE(capture.update(120000) == false);
+        REQUIRE(capture.lastRelease() == 100000);
+    }
+
+    SECTION("Should accept a level when the next edge is after the debounce time") {
+        capture.capture(true, 1000);
+        capture.capture(false, 50000);
+        capture.update(50001);
+        REQUIRE(capture.lastPress() == 1000);
+        REQUIRE(capture.update(60000) == false);
+        REQUIRE(capture.lastRelease() == 50000);
+    }
+
+    SECTION("Should count glitches") {
+        capture.capture(true, 1000);
+        capture.capture(false, 1200);
+        REQUIRE(capture.update(10000) == false);
+        REQUIRE(capture.glitches() == 1);
+        REQUIRE(capture.lastPress() == 0);
+    }
+
+    SECTION("Should not accept an edge captured after the update time") {
+        capture.capture(true, 20000);
+        REQUIRE(capture.update(19000) == false);
+        REQUIRE(capture.update(25000) == true);
+    }
+
+    SECTION("Should count lost edges and skip edges without a level change") {
+        for (uint32_t i = 0; i < EDGE_CAPTURE_SIZE + 3; i++) {
+            capture.capture(true, 1000 + i);
+        }
+
+        REQUIRE(capture.overflows() == 3);
+        REQUIRE(capture.update(10000) == true);
+        REQUIRE(capture.edges() == 1);
+    }
+
+    SECTION("Should drive the click detection of DigitalKnob") {
+        DigitalKnob knob(1, false, 100);
+        bool single = false;
+
+        bounce(1000, true, 5);
+        bounce(161000, false, 5);
+
+        for (uint32_t now = 0; now < 1000000; now += 20000) {
+            knob.handleDebounced(capture.update(now));
+            single = single || knob.isSingle();
+        }
+
+        REQUIRE(single);
+        REQUIRE(capture.lastPress() == 1000);
+        REQUIRE(capture.lastRelease() == 161000);
+    }
+
+    SECTION("Should keep every accepted change until it is read") {
+        EdgeCapture::Edge change;
+
+        // Pressed and released between two reads
+        bounce(1000, true, 3);
+        bounce(20000, false, 3);
+        REQUIRE(capture.update(40000) == false);
+
+        REQUIRE(capture.nextChange(change));
+        REQUIRE(change.m_level);
+        REQUIRE(change.m_time == 1000);
+        REQUIRE(capture.nextChange(change));
+        REQUIRE_FALSE(change.m_level);
+        REQUIRE(change.m_time == 20000);
+        REQUIRE_FALSE(capture.nextChange(change));
+
+        for (int i = 0; i < EDGE_CAPTURE_CHANGES; i++) {
+            bounce(100000 + i * 20000, i % 2 == 0, 1);
+        }
+
+        capture.update(400000);
+        REQUIRE(capture.changeOverflows() == 0);
+        bounce(400000, true, 1);
+        capture.update(500000);
+        REQUIRE(capture.changeOverflows() == 1);
+    }
+
+    SECTION("Should adapt the debounce time to the noise on the line") {
+        capture.adaptiveDebounce(2000, 20000);
+        uint32_t now = 0;
+
+        // A 30ms press that passes the debounce time every period
+        for (int period = 0; period < 10; period++) {
+            bounce(now + 1000, true, 3);
+            bounce(now + 31000, false, 3);
+
+            for (uint32_t end = now + EDGE_CAPTURE_ADAPT_PERIOD; now < end;) {
+                now += 1000;
+                capture.update(now);
+            }
+        }
+
+        REQUIRE(capture.shortPresses() == 10);
+        REQUIRE(capture.debounce() == 20000);
+
+        // A 10ms pulse is a glitch now, the debounce time holds
+        bounce(now + 1000, true, 1);
+        bounce(now + 11000, false, 1);
+
+        for (uint32_t end = now + EDGE_CAPTURE_ADAPT_PERIOD; now < end;) {
+            now += 1000;
+            capture.update(now);
+        }
+
+        REQUIRE(capture.glitches() == 1);
+        REQUIRE(capture.debounce() == 20000);
+
+        // Down to the minimum on a clean line
+        for (int period = 0; period < 30; period++) {
+            now += EDGE_CAPTURE_ADAPT_PERIOD;
+            capture.update(now);
+        }
+
+        REQUIRE(capture.debounce() == 2000);
+        REQUIRE(capture.shortPresses() == 10);
+    }
+
+    SECTION("Should keep a fixed debounce time with equal bounds") {
+        capture.adaptiveDebounce(8000, 8000);
+        capture.update(EDGE_CAPTURE_ADAPT_PERIOD);
+        REQUIRE(capture.debounce() == 8000);
+        capture.update(2 * EDGE_CAPTURE_ADAPT_PERIOD);
+        REQUIRE(capture.debounce() == 8000);
+    }
+
+    SECTION("Should time the press events of DigitalKnob with the captured edges") {
+        DigitalKnob knob(1, false, 100);
+        PressEvent events[DIGITAL_INPUT_EVENTS];
+
+        for (uint32_t now = 0; now < 1000000; now += 20000) {
+            // Edges arrive between two updates, like from the interrupt
+            if (now == 20000) {
+                bounce(3000, true, 5);
+            } else if (now == 180000) {
+                bounce(170000, false, 5);
+            }
+
+            millisStubbed = now / 1000;
+            bool level = capture.update(now);
+            uint32_t edgeAge = now - (level ? capture.lastPress() : capture.lastRelease());
+            knob.handleDebounced(level, millisStubbed - edgeAge / 1000);
+        }
+
+        REQUIRE(knob.events(events, DIGITAL_INPUT_EVENTS) == 3);
+        REQUIRE(events[0].m_type == PressEvent::EDGE_UP);
+        REQUIRE(events[0].m_start == 3);
+        REQUIRE(events[1].m_type == PressEvent::EDGE_DOWN);
+        REQUIRE(events[1].m_duration == 167);
+        REQUIRE(events[2].m_type == PressEvent::SINGLE);
+        REQUIRE(events[2].m_start == 3);
+        REQUIRE(events[2].m_duration == 167);
+    }
+
+    SECTION("Should pass a press that is accepted and released within one frame to DigitalKnob") {
+        DigitalKnob knob(1, false, 100);
+        PressEvent events[DIGITAL_INPUT_EVENTS];
+        bool edgeUp = false;
+        bool edgeDown = false;
+
+        for (uint32_t now = 1000; now <= 100000; now += 1000) {
+            // The interrupt updates every ms, a 12ms press between two frames
+            if (now == 21000) {
+                bounce(21000, true, 1);
+            } else if (now == 33000) {
+                bounce(33000, false, 1);
+            }
+
+            capture.update(now);
+
+            if (now % 20000 == 0) {
+                millisStubbed = now / 1000;
+                EdgeCapture::Edge change;
+
+                while (capture.nextChange(change)) {
+                    knob.handleChange(change.m_level, millisStubbed - (now - change.m_time) / 1000);
+                }
+
+                knob.handleTick();
+                edgeUp = edgeUp || knob.isEdgeUp();
+                edgeDown = edgeDown || knob.isEdgeDown();
+                REQUIRE(knob.isEdgeUp() == (now == 40000));
+            }
+        }
+
+        REQUIRE(edgeUp);
+        REQUIRE(edgeDown);
+        REQUIRE(knob.events(events, DIGITAL_INPUT_EVENTS) == 2);
+        REQUIRE(events[0].m_type == PressEvent::EDGE_UP);
+        REQUIRE(events[0].m_start == 21);
+        REQUIRE(events[1].m_type == PressEvent::EDGE_DOWN);
+        REQUIRE(events[1].m_duration == 12);
+        REQUIRE(knob.shortPresses() == 1);
+    }
+}
@@ -0,0 +1,46 @@
+#include <catch2/catch.hpp>
+
+#include "arduinostubs.hpp"
+
+#include <fastpin.h>
+#include <digitalknob.h>
+
+TEST_CASE("Fast pin", "[fastpin]") {
+    GPIStubbed = 0;
+    GPOStubbed = 0;
+
+    SECTION("Should read a single bit of the input register") {
+        GPIStubbed = 1 << 12;
+        REQUIRE(FastPin<12>::read());
+        REQUIRE_FALSE(FastPin<12, true>::read());
+        REQUIRE_FALSE(FastPin<4>::read());
+        REQUIRE(FastPin<4, true>::read());
+    }
+
+    SECTION("Should set and clear a single bit of the output register") {
+        FastPin<14>::write(true);
+        FastPin<2>::write(true);
+        REQUIRE(GPOStubbed == ((1 << 14) | (1 << 2)));
+        FastPin<14>::write(false);
+        REQUIRE(GPOStubbed == 1 << 2);
+        FastPin<2, true>::write(true);
+        REQUIRE(GPOStubbed == 0);
+        FastPin<2, true>::write(false);
+        REQUIRE(GPOStubbed == 1 << 2);
+    }
+
+    SECTION("Should debounce the same as reading the pin with digitalRead") {
+        DigitalKnob read(12, true, 110);
+        DigitalKnob fast(12, false, 110);
+
+        for (uint32_t i = 0; i < 2000; i++) {
+            bool level = i % 97 < 30 || i % 13 == 0;
+            digitalReadStubbed = level;
+            GPIStubbed = level ? 1 << 12 : 0;
+            read.handle();
+            fast.handle(FastPin<12, true>::read());
+            REQUIRE(read.current() == fast.current());
+            REQUIRE(read.presses() == fast.presses());
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#include <catch2/catch.hpp>
+
+#include <frameclock.h>
+#include <string>
+
+TEST_CASE("Frame clock", "[frameclock]") {
+    FrameClock clock(20000, FrameClock::CATCH_UP_BURST);
+    clock.start(1000);
+
+    // Runs all frames that are due at p_now, returns the number of frames
+    auto runAt = [&clock](uint32_t p_now) {
+        uint32_t frames = 0;
+
+        while (clock.tick(p_now)) {
+            frames++;
+        }
+
+        return frames;
+    };
+
+    SECTION("Should run frames at the period") {
+        REQUIRE(clock.tick(1000));
+        REQUIRE_FALSE(clock.tick(1000));
+        REQUIRE_FALSE(clock.tick(20999));
+        REQUIRE(clock.tick(21000));
+        REQUIRE(clock.tick(41300));
+        REQUIRE(clock.jitter(0) == 2);
+        // 300us late
+        REQUIRE(clock.jitter(9) == 1);
+        REQUIRE(clock.overruns() == 0);
+        REQUIRE(clock.longestStall() == 300);
+    }
+
+    SECTION("Should handle the wrap of the time source") {
+        clock.start(0xFFFFFFFF - 5000);
+        REQUIRE(clock.tick(0xFFFFFFFF - 5000));
+        REQUIRE_FALSE(clock.tick(0xFFFFFFFF));
+        REQUIRE_FALSE(clock.tick(10000));
+        REQUIRE(clock.tick(15000));
+    }
+
+    SECTION("Should burst missed frames") {
+        runAt(1000);
+        REQUIRE(runAt(71000) == 3);
+        REQUIRE(clock.overruns() == 2);
+        REQUIRE(clock.skipped() == 0);
+        REQUIRE(runAt(81000) == 1);
+    }
+
+    SECTION("Should skip missed frames and keep the phase") {
+        clock.catchUp(FrameClock::CATCH_UP_SKIP);
+        runAt(1000);
+        REQUIRE(runAt(71000) == 1);
+        REQUIRE(clock.overruns() == 1);
+        REQUIRE(clock.skipped() == 2);
+        REQUIRE_FALSE(clock.tick(80999));
+        REQUIRE(clock.tick(81000));
+    }
+
+    SECTION("Should resync after missed frames") {
+        clock.catchUp(FrameClock::CATCH_UP_RESYNC);
+        runAt(1000);
+        REQUIRE(runAt(71000) == 1);
+        REQUIRE(clock.skipped() == 2);
+        REQUIRE_FALSE(clock.tick(90999));
+        REQUIRE(clock.tick(91000));
+    }
+
+    SECTION("Should blame the longest section before a stall") {
+        clock.catchUp(FrameClock::CATCH_UP_SKIP);
+        runAt(1000);
+        clock.blame("knob", 100);
+        clock.blame("mqtt", 45000);
+        clock.blame("wm", 200);
+        runAt(51000);
+        clock.blame("knob", 100);
+        runAt(71000);
+
+        REQUIRE(clock.longestStall() == 30000);
+        REQUIRE(std::string(clock.stallCause()) == "mqtt");
+        REQUIRE(clock.jitter(FRAME_CLOCK_BUCKETS - 1) == 1);
+
+        clock.resetStats();
+        REQUIRE(clock.frames() == 0);
+        REQUIRE(clock.longestStall() == 0);
+        REQUIRE(std::string(clock.stallCause()) == "");
+    }
+}
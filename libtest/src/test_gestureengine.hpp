@@ -0,0 +1,106 @@
+#include <catch2/catch.hpp>
+
+#include <gestureengine.h>
+#include <string>
+
+TEST_CASE("Gesture engine", "[gestures]") {
+    // 20ms ticks, 400ms is a long press and a 300ms release ends a gesture
+    GestureEngine engine(20, 400, 300);
+    REQUIRE(engine.add("single", "."));
+    REQUIRE(engine.add("double", ".."));
+    REQUIRE(engine.add("long", "-"));
+    REQUIRE(engine.add("knock", ".-."));
+
+    std::string matched;
+
+    // Press for p_press ms and release for p_release ms, collects the names of matched gestures
+    auto press = [&](uint16_t p_press, uint16_t p_release) {
+        for (uint16_t t = 0; t < p_press + p_release; t += 20) {
+            int8_t gesture = engine.handle(t < p_press);
+
+            if (gesture >= 0) {
+                matched += matched.empty() ? "" : " ";
+                matched += engine.name(gesture);
+            }
+        }
+    };
+
+    SECTION("Should wait for the gap before a single press") {
+        press(100, 280);
+        REQUIRE(matched == "");
+        press(0, 40);
+        REQUIRE(matched == "single");
+    }
+
+    SECTION("Should match a double press") {
+        press(100, 100);
+        press(100, 400);
+        REQUIRE(matched == "double");
+    }
+
+    SECTION("Should match at once when no longer gesture can follow") {
+        press(100, 100);
+        press(100, 20);
+        REQUIRE(matched == "double");
+    }
+
+    SECTION("Should match a knock code") {
+        press(100, 100);
+        press(500, 100);
+        press(100, 400);
+        REQUIRE(matched == "knock");
+    }
+
+    SECTION("Should count sequences that do not match") {
+        press(100, 100);
+        press(500, 100);
+        press(500, 400);
+        press(500, 400);
+        REQUIRE(matched == "long");
+        REQUIRE(engine.unmatched() == 1);
+    }
+
+    SECTION("Should reject invalid, duplicate and too many gestures") {
+        REQUIRE_FALSE(engine.add("bad", ".x"));
+        REQUIRE_FALSE(engine.add("empty", ""));
+        REQUIRE_FALSE(engine.add("again", ".."));
+
+        for (uint8_t i = engine.size(); i < GESTURE_ENGINE_GESTURES; i++) {
+            REQUIRE(engine.add("extra", std::string(i, '-').c_str()));
+        }
+
+        REQUIRE_FALSE(engine.add("full", "----------"));
+    }
+
+    SECTION("Should load gestures from properties") {
+        Properties properties;
+        properties.put("gesture.triple", PropertyValue("..."));
+        properties.put("gesture.sos", PropertyValue("...---..."));
+        properties.put("gesture.number", PropertyValue(3));
+        properties.put("ringerOn", PropertyValue(true));
+        REQUIRE(loadGestures(engine, properties) == 2);
+        REQUIRE(std::string(engine.name(0)) == "sos");
+
+        press(100, 100);
+        press(100, 100);
+        press(100, 400);
+        REQUIRE(matched == "triple");
+    }
+
+    SECTION("Should check a gesture before it is stored") {
+        Properties properties;
+        properties.put("gesture.triple", PropertyValue("..."));
+        REQUIRE(canAddGesture(properties, "knock", ".-."));
+        REQUIRE_FALSE(canAddGesture(properties, "knock", "..."));
+        REQUIRE_FALSE(canAddGesture(properties, "knock", ".x"));
+        // Replaces the gesture with the same name
+        REQUIRE(canAddGesture(properties, "triple", "..."));
+
+        for (uint8_t i = 1; i < GESTURE_ENGINE_GESTURES; i++) {
+            properties.put(("gesture.g" + std::to_string(i)).c_str(), PropertyValue(std::string(i, '-').c_str()));
+        }
+
+        REQUIRE_FALSE(canAddGesture(properties, "full", "--.--"));
+        REQUIRE(canAddGesture(properties, "g1", "--.--"));
+    }
+}
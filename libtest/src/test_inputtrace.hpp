@@ -0,0 +1,139 @@
+#include <catch2/catch.hpp>
+
+#include "tracereplay.hpp"
+
+#include <inputtrace.h>
+#include <digitalknob.h>
+#include <string>
+#include <vector>
+
+TEST_CASE("Input trace", "[inputtrace]") {
+    InputTrace trace(100);
+
+    SECTION("Should only store changes as runs") {
+        trace.start(false, 1000);
+        REQUIRE(trace.record(false, 1500));
+        REQUIRE(trace.record(true, 2050));
+        REQUIRE(trace.record(true, 3000));
+        REQUIRE(trace.record(false, 2050 + 2000));
+        trace.stop(10000);
+        REQUIRE_FALSE(trace.recording());
+        REQUIRE_FALSE(trace.record(true, 11000));
+        REQUIRE(trace.size() == 3);
+
+        std::vector<uint32_t> runs;
+        trace.forEach([&](bool p_level, uint32_t p_start, uint32_t p_duration) {
+            runs.insert(runs.end(), {p_level, p_start, p_duration});
+        });
+        REQUIRE(runs == std::vector<uint32_t>({0, 0, 1000, 1, 1000, 2000, 0, 3000, 6000}));
+    }
+
+    SECTION("Should split long runs and combine them again") {
+        trace.start(true, 0);
+        trace.stop(100 * (INPUT_TRACE_MAX_RUN + 10));
+        REQUIRE(trace.size() == 2);
+
+        uint32_t calls = 0;
+        trace.forEach([&](bool p_level, uint32_t p_start, uint32_t p_duration) {
+            REQUIRE(p_level);
+            REQUIRE(p_start == 0);
+            REQUIRE(p_duration == 100 * (INPUT_TRACE_MAX_RUN + 10));
+            calls++;
+        });
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("Should stop when full") {
+        trace.start(false, 0);
+
+        for (uint32_t i = 1; i <= INPUT_TRACE_RUNS; i++) {
+            REQUIRE(trace.record(i % 2, i * 100) == (i < INPUT_TRACE_RUNS));
+        }
+
+        REQUIRE(trace.full());
+        REQUIRE_FALSE(trace.recording());
+    }
+
+    SECTION("Should format in parts and parse it back") {
+        trace.start(false, 0);
+        trace.record(true, 1200);
+        trace.record(false, 1300);
+        trace.record(true, 5000);
+        trace.stop(100000);
+
+        char buffer[12];
+        uint16_t entry = 0;
+        std::string text;
+
+        while (trace.format(buffer, sizeof(buffer), entry) > 0) {
+            text += buffer;
+        }
+
+        REQUIRE(text == "-12 +1 -37 +950 ");
+
+        InputTrace copy(100);
+        REQUIRE(copy.parse(text.c_str()));
+        REQUIRE(copy.size() == 4);
+        REQUIRE_FALSE(copy.parse("+12 x3"));
+    }
+}
+
+TEST_CASE("Replay traces through DigitalKnob", "[inputtrace]") {
+    DigitalKnob knob(1, false, 110);
+    TraceScorer scorer(1);
+
+    SECTION("Should detect clean presses") {
+        scorer.m_generator.m_bounces = 0;
+        scorer.score(knob, 20, PressEvent::SINGLE, 50);
+        scorer.score(knob, 20, PressEvent::DOUBLE, 50);
+        scorer.score(knob, 20, PressEvent::LONG, 50);
+        REQUIRE(scorer.m_presses == 150);
+        REQUIRE(scorer.m_correct == 150);
+        REQUIRE(scorer.m_maxLatency <= 20);
+    }
+
+    SECTION("Should detect bouncing presses") {
+        scorer.score(knob, 20, PressEvent::SINGLE, 500);
+        scorer.score(knob, 20, PressEvent::DOUBLE, 500);
+        scorer.score(knob, 20, PressEvent::LONG, 500);
+        REQUIRE(scorer.m_missed == 0);
+        REQUIRE(scorer.m_falseEdges == 0);
+        REQUIRE(scorer.accuracy() >= 0.99);
+    }
+
+    SECTION("Should filter more noise with a higher alpha") {
+        DigitalKnob filtered(1, false, 300);
+        TraceScorer filteredScorer(1);
+        scorer.m_generator.m_noiseInterval = 50000;
+        filteredScorer.m_generator.m_noiseInterval = 50000;
+        scorer.score(knob, 20, PressEvent::SINGLE, 500);
+        filteredScorer.score(filtered, 20, PressEvent::SINGLE, 500);
+        REQUIRE(filteredScorer.m_falseEdges < scorer.m_falseEdges);
+        REQUIRE(filteredScorer.accuracy() > scorer.accuracy());
+        REQUIRE(filteredScorer.averageLatency() > scorer.averageLatency());
+    }
+
+    SECTION("Should replay a recorded trace") {
+        InputTrace trace(100);
+        trace.parse("-500 +1 -2 +4 -1 +2000 -3 +1 -8000");
+        millisStubbed = 0;
+        replay(trace, knob, 20);
+
+        PressEvent events[DIGITAL_INPUT_EVENTS];
+        REQUIRE(knob.events(events, DIGITAL_INPUT_EVENTS) == 3);
+        REQUIRE(events[2].m_type == PressEvent::SINGLE);
+    }
+}
+
+TEST_CASE("Score generated presses", "[!benchmark][inputtrace]") {
+    DigitalKnob knob(1, false, 110);
+    TraceScorer scorer(1);
+    scorer.m_generator.m_noiseInterval = 50000;
+
+    BENCHMARK("Score 100000 single presses with bounce and noise") {
+        scorer.score(knob, 20, PressEvent::SINGLE, 100000);
+    }
+
+    WARN("accuracy " << scorer.accuracy() << " false edges " << scorer.m_falseEdges << " average latency "
+         << scorer.averageLatency() << "ms max latency " << scorer.m_maxLatency << "ms");
+}
@@ -0,0 +1,93 @@
+#include <catch2/catch.hpp>
+
+#include <persistscheduler.h>
+
+TEST_CASE("Persist scheduler", "[persistscheduler]") {
+    PersistScheduler scheduler(30000, 4);
+    uint32_t now = 1000;
+
+    SECTION("Should not write without changes") {
+        REQUIRE(scheduler.isDue(now) == false);
+        REQUIRE(scheduler.isPending() == false);
+    }
+
+    SECTION("Should coalesce changes until the quiet window passed") {
+        for (int i = 0; i < 20; i++) {
+            scheduler.changed(now, false);
+            now += 1000;
+            REQUIRE(scheduler.isDue(now) == false);
+        }
+
+        REQUIRE(scheduler.isDue(now + 28999) == false);
+        REQUIRE(scheduler.isDue(now + 29000));
+        scheduler.started();
+        scheduler.written(now + 29000, 1500, true);
+        REQUIRE(scheduler.isPending() == false);
+        REQUIRE(scheduler.writesMade() == 1);
+        REQUIRE(scheduler.writesAvoided() == 19);
+        REQUIRE(scheduler.worstLatency() == 1500);
+    }
+
+    SECTION("Should write critical changes immediately") {
+        scheduler.changed(now, false);
+        scheduler.changed(now, true);
+        REQUIRE(scheduler.isDue(now));
+        scheduler.started();
+        scheduler.written(now, 800, true);
+        REQUIRE(scheduler.isDue(now + 60000) == false);
+    }
+
+    SECTION("Should enforce the daily budget") {
+        for (int i = 0; i < 4; i++) {
+            scheduler.changed(now, false);
+            now += 30000;
+            REQUIRE(scheduler.isDue(now));
+            scheduler.started();
+            scheduler.written(now, 1000, true);
+        }
+
+        REQUIRE(scheduler.budgetLeft() == 0);
+        scheduler.changed(now, false);
+        now += 30000;
+        REQUIRE(scheduler.isDue(now) == false);
+
+        // Critical changes are written regardless of the budget
+        scheduler.changed(now, true);
+        REQUIRE(scheduler.isDue(now));
+        scheduler.started();
+        scheduler.written(now, 1000, true);
+
+        scheduler.changed(now, false);
+        REQUIRE(scheduler.isDue(24ul * 60 * 60 * 1000 - 1) == false);
+        REQUIRE(scheduler.isDue(24ul * 60 * 60 * 1000));
+        REQUIRE(scheduler.budgetLeft() == 4);
+    }
+
+    SECTION("Should keep changes made during a write pending") {
+        scheduler.changed(now, true);
+        REQUIRE(scheduler.isDue(now));
+        scheduler.started();
+        scheduler.changed(now + 10, false);
+        scheduler.written(now + 20, 1000, true);
+        REQUIRE(scheduler.isPending());
+        REQUIRE(scheduler.writesAvoided() == 0);
+        REQUIRE(scheduler.isDue(now + 30010));
+    }
+
+    SECTION("Should retry failed writes after the quiet window") {
+        scheduler.changed(now, true);
+        REQUIRE(scheduler.isDue(now));
+        scheduler.started();
+        scheduler.written(now, 5000, false);
+        REQUIRE(scheduler.isPending());
+        REQUIRE(scheduler.isDue(now + 1000) == false);
+        REQUIRE(scheduler.isDue(now + 30000));
+    }
+
+    SECTION("Should handle millis() wrap around") {
+        now = UINT32_MAX - 10000;
+        scheduler.changed(now, false);
+        REQUIRE(scheduler.isDue(now + 20000) == false);
+        REQUIRE(scheduler.isDue(now + 30000));
+    }
+}
@@ -0,0 +1,73 @@
+#include <catch2/catch.hpp>
+
+#include <profiler.h>
+#include <string>
+
+TEST_CASE("Profiler", "[profiler]") {
+    Profiler profiler(80);
+    uint8_t knob = profiler.section("knob");
+
+    SECTION("Should register sections once") {
+        REQUIRE(profiler.section("mqtt") == 1);
+        REQUIRE(profiler.section("knob") == knob);
+        REQUIRE(profiler.size() == 2);
+        REQUIRE(std::string(profiler.name(1)) == "mqtt");
+    }
+
+    SECTION("Should ignore sections that do not fit") {
+        char names[PROFILER_SECTIONS][8];
+
+        for (uint8_t i = 1; i < PROFILER_SECTIONS; i++) {
+            snprintf(names[i], sizeof(names[i]), "s%u", i);
+            REQUIRE(profiler.section(names[i]) == i);
+        }
+
+        REQUIRE(profiler.section("full") == PROFILER_SECTIONS);
+        profiler.record(PROFILER_SECTIONS, 100);
+    }
+
+    SECTION("Should map cycles to buckets within 25%") {
+        for (uint32_t cycles = 0; cycles < 100000; cycles = cycles * 5 / 4 + 1) {
+            uint8_t bucket = Profiler::bucket(cycles);
+            REQUIRE(Profiler::bucketLimit(bucket) >= cycles);
+            REQUIRE((bucket == 0 || Profiler::bucketLimit(bucket - 1) < cycles));
+            REQUIRE(Profiler::bucketLimit(bucket) <= cycles + cycles / 4);
+        }
+
+        REQUIRE(Profiler::bucket(UINT32_MAX) == PROFILER_BUCKETS - 1);
+    }
+
+    SECTION("Should keep min, average, max and percentiles") {
+        for (uint32_t i = 0; i < 99; i++) {
+            profiler.record(knob, 800);
+        }
+
+        profiler.record(knob, 80000);
+
+        REQUIRE(profiler.count(knob) == 100);
+        REQUIRE(profiler.min(knob) == 800);
+        REQUIRE(profiler.max(knob) == 80000);
+        REQUIRE(profiler.average(knob) == 1592);
+        REQUIRE(profiler.percentile(knob, 50) >= 800);
+        REQUIRE(profiler.percentile(knob, 50) <= 1000);
+        REQUIRE(profiler.percentile(knob, 99) <= 1000);
+        REQUIRE(profiler.percentile(knob, 100) == 80000);
+
+        char buffer[64];
+        profiler.format(knob, buffer, sizeof(buffer));
+        // p99 is the upper limit of the bucket of 800 cycles
+        REQUIRE(std::string(buffer) == "100/10.00/19.90/11.18/1000.00");
+
+        profiler.reset();
+        REQUIRE(profiler.count(knob) == 0);
+        REQUIRE(profiler.min(knob) == 0);
+        REQUIRE(profiler.percentile(knob, 99) == 0);
+    }
+
+    SECTION("Should measure a scope") {
+        {
+            ProfileScope scope(profiler, knob);
+        }
+        REQUIRE(profiler.count(knob) == 1);
+    }
+}
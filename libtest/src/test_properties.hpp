@@ -1,9 +1,12 @@
 #include <catch2/catch.hpp>
 
+#include "allocationcounter.hpp"
+
 #include <memory>
 #include <propertyutils.h>
 #include <string>
 #include <array>
+#include <type_traits>
 
 using Catch::Matchers::Equals;
 
@@ -60,4 +63,229 @@ TEST_CASE("Scenario Properties", "[properties]") {
         REQUIRE_THAT((const char*)properties.get("stringValue"), Equals("ab"));
     }
 
-}
\ No newline at end of file
+    SECTION("Should find values by PropertyKey") {
+        constexpr PropertyKey LONG_VALUE{"longValue"};
+        constexpr PropertyKey CHAR_VALUE{"charValue"};
+        static_assert(LONG_VALUE.hash() == PropertyKey::hash("longValue"), "Must hash at compile time");
+        properties.put("longValue", PV(689876));
+        properties.put(CHAR_VALUE, PV("string value"));
+        REQUIRE(properties.contains(LONG_VALUE));
+        REQUIRE((long)properties.get(LONG_VALUE) == 689876);
+        REQUIRE_THAT((const char*)properties.get("charValue"), Equals("string value"));
+        properties.put(LONG_VALUE, PV(12));
+        REQUIRE((long)properties.get("longValue") == 12);
+        properties.erase("longValue");
+        REQUIRE(properties.contains(LONG_VALUE) == false);
+        REQUIRE_THAT((const char*)properties.get(CHAR_VALUE), Equals("string value"));
+    }
+
+    SECTION("Should round trip PropertyKey names through a stream") {
+        constexpr PropertyKey RINGER_ON{"ringerOn"};
+        constexpr PropertyKey MAX_RING_TIME{"maxRingTime"};
+        properties.put(RINGER_ON, PV(true));
+        properties.put(MAX_RING_TIME, PV(5000));
+        Stream out;
+        serializeProperties<32>(out, properties);
+        REQUIRE_THAT(out.streamedOut(), Equals("maxRingTime=L5000\nringerOn=B1\n"));
+
+        Properties restored;
+        Stream in(out.streamedOut());
+        deserializeProperties<32>(in, restored);
+        REQUIRE((bool)restored.get(RINGER_ON) == true);
+        REQUIRE((long)restored.get(MAX_RING_TIME) == 5000);
+    }
+
+    SECTION("Should find keys that did not fit in the index") {
+        char name[8];
+
+        for (int i = 0; i < PROPERTIES_INDEX_SIZE + 8; i++) {
+            snprintf(name, sizeof(name), "k%d", i);
+            properties.put(name, PV((int32_t)i));
+        }
+
+        Properties copy = properties;
+        constexpr PropertyKey FIRST{"k0"};
+        constexpr PropertyKey LAST{"k39"};
+        REQUIRE((long)copy.get(FIRST) == 0);
+        REQUIRE((long)copy.get(LAST) == PROPERTIES_INDEX_SIZE + 7);
+    }
+
+    SECTION("Should not find an absent key with the hash of a stored key") {
+        constexpr PropertyKey STORED{"gwzx"};
+        constexpr PropertyKey ABSENT{"16cd"};
+        static_assert(STORED.hash() == ABSENT.hash(), "Names must collide");
+        properties.put("gwzx", PV(1));
+        REQUIRE(properties.contains(STORED));
+        REQUIRE_FALSE(properties.contains(ABSENT));
+        properties.put("16cd", PV(2));
+        REQUIRE((long)properties.get(STORED) == 1);
+        REQUIRE((long)properties.get(ABSENT) == 2);
+    }
+
+    SECTION("Should find keys by PropertyKey after unsorted inserts and erases") {
+        constexpr PropertyKey A{"a"};
+        constexpr PropertyKey B{"b"};
+        constexpr PropertyKey C{"c"};
+        properties.put("c", PV(3));
+        REQUIRE((long)properties.get(C) == 3);
+        properties.put("b", PV(2));
+        properties.put("a", PV(1));
+        REQUIRE((long)properties.get(A) == 1);
+        REQUIRE((long)properties.get(B) == 2);
+        REQUIRE((long)properties.get(C) == 3);
+        properties.erase("b");
+        properties.put("d", PV(4));
+        REQUIRE_FALSE(properties.contains(B));
+        REQUIRE((long)properties.get(C) == 3);
+        REQUIRE((long)properties.get(PropertyKey("d")) == 4);
+    }
+
+    SECTION("Should keep entries sorted and compact erased names") {
+        properties.put("c", PV(3));
+        properties.put("a", PV(1));
+        properties.put("b", PV(2));
+        properties.put("aVeryLongNameThatWillBeErased", PV(4));
+        size_t arenaSize = properties.arenaSize();
+        properties.erase("aVeryLongNameThatWillBeErased");
+        REQUIRE(properties.size() == 3);
+        REQUIRE(properties.arenaSize() < arenaSize);
+        REQUIRE((long)properties.get("a") == 1);
+        REQUIRE((long)properties.get("b") == 2);
+        REQUIRE((long)properties.get("c") == 3);
+        Stream stream;
+        serializeProperties<32>(stream, properties);
+        REQUIRE_THAT(stream.streamedOut(), Equals("a=L1\nb=L2\nc=L3\n"));
+    }
+
+    SECTION("Should not allocate on updates of existing keys") {
+        constexpr PropertyKey RINGER_ON{"ringerOn"};
+        constexpr PropertyKey MAX_RING_TIME{"maxRingTime"};
+        constexpr PropertyKey MQTT_SERVER{"mqttServer"};
+        properties.put(RINGER_ON, PV(true));
+        properties.put(MAX_RING_TIME, PV(5000));
+        properties.put(MQTT_SERVER, PV("mqtt2.home.example.org"));
+        const PropertyValue serverA("mqtt.home.example.org");
+        const PropertyValue serverB("mqtt2.home.example.org");
+        size_t arenaSize = properties.arenaSize();
+
+        uint32_t allocations = allocationCounter;
+
+        for (int32_t i = 0; i < 1000000; i++) {
+            properties.put(RINGER_ON, PV((i & 1) == 0));
+            properties.put("maxRingTime", PV(i));
+            properties.put(MQTT_SERVER, (i & 1) == 0 ? serverA : serverB);
+        }
+
+        REQUIRE(allocationCounter - allocations == 0);
+        REQUIRE(properties.arenaSize() == arenaSize);
+        REQUIRE((long)properties.get(MAX_RING_TIME) == 999999);
+    }
+
+    SECTION("Should track dirty keys") {
+        constexpr PropertyKey RINGER_ON{"ringerOn"};
+        constexpr PropertyKey MQTT_SERVER{"mqttServer"};
+        properties.put(RINGER_ON, PV(true));
+        properties.put(MQTT_SERVER, PV("mqtt.home.example.org"));
+        REQUIRE(properties.isDirty(RINGER_ON));
+        REQUIRE(properties.isDirty());
+        properties.clearDirty();
+        REQUIRE(properties.isDirty() == false);
+
+        properties.put(RINGER_ON, PV(true));
+        properties.put("mqttServer", PV("mqtt.home.example.org"));
+        REQUIRE(properties.isDirty() == false);
+
+        properties.put(RINGER_ON, PV(false));
+        REQUIRE(properties.isDirty(RINGER_ON));
+        REQUIRE(properties.isDirty(MQTT_SERVER) == false);
+        std::string dirty;
+        properties.forEachDirty([&dirty](const char* p_name, const PropertyValue&) {
+            dirty += p_name;
+        });
+        REQUIRE(dirty == "ringerOn");
+
+        properties.clearDirty();
+        properties.erase("mqttServer");
+        REQUIRE(properties.isErased());
+        REQUIRE(properties.isDirty());
+        properties.clearDirty();
+        REQUIRE(properties.isErased() == false);
+    }
+
+}
+
+TEST_CASE("PropertyValue storage", "[properties]") {
+    const char* shortString = "DOORBELL00C0FFEE/status";
+    const char* longString = "a string that does not fit inline in a PropertyValue";
+
+    SECTION("Should be small and without vtable") {
+        REQUIRE(std::is_polymorphic<PropertyValue>::value == false);
+        REQUIRE(std::is_nothrow_move_constructible<PropertyValue>::value);
+        REQUIRE(std::is_nothrow_move_assignable<PropertyValue>::value);
+        REQUIRE(sizeof(PropertyValue) <= PROPERTY_VALUE_INLINE_SIZE + sizeof(void*));
+        REQUIRE(sizeof(PropertyValue) < sizeof(std::string) + 2 * sizeof(void*));
+    }
+
+    SECTION("Should store short strings without allocation") {
+        uint32_t allocations = allocationCounter;
+        PV value(shortString);
+        PV copy(value);
+        PV moved(std::move(copy));
+        REQUIRE(allocationCounter - allocations == 0);
+        REQUIRE_THAT((const char*)value, Equals(shortString));
+        REQUIRE_THAT((const char*)moved, Equals(shortString));
+    }
+
+    SECTION("Should move long strings without allocation") {
+        PV value(longString);
+        uint32_t allocations = allocationCounter;
+        PV moved(std::move(value));
+        PV assigned(1);
+        assigned = std::move(moved);
+        REQUIRE(allocationCounter - allocations == 0);
+        REQUIRE_THAT((const char*)assigned, Equals(longString));
+        REQUIRE((long)value == 0);
+    }
+
+    SECTION("Should copy long strings once and re-use the buffer") {
+        PV value(longString);
+        const PV shortValue("short");
+        uint32_t allocations = allocationCounter;
+        PV copy(value);
+        REQUIRE(allocationCounter - allocations == 1);
+        copy = shortValue;
+        REQUIRE_THAT((const char*)copy, Equals("short"));
+        copy = value;
+        REQUIRE(allocationCounter - allocations == 1);
+        REQUIRE_THAT((const char*)copy, Equals(longString));
+        copy = PV(true);
+        REQUIRE((bool)copy == true);
+    }
+
+    SECTION("Should move values into Properties") {
+        Properties properties;
+        properties.put("long", PV(longString));
+        properties.put("short", PV(shortString));
+        uint32_t allocations = allocationCounter;
+        properties.put("long", PV(longString));
+        properties.put("short", PV(shortString));
+        // Only the temporary long string allocates, it´s moved into the existing entry
+        REQUIRE(allocationCounter - allocations == 1);
+        REQUIRE_THAT((const char*)properties.get("long"), Equals(longString));
+        REQUIRE_THAT((const char*)properties.get("short"), Equals(shortString));
+    }
+}
+
+TEST_CASE("Properties unsorted inserts", "[!benchmark][properties]") {
+    char name[8];
+
+    // Every put lands in front of the existing keys
+    BENCHMARK("2000 puts in reverse order") {
+        Properties properties;
+
+        for (int i = 2000; i > 0; i--) {
+            snprintf(name, sizeof(name), "k%04d", i);
+            properties.put(name, PV((int32_t)i));
+        }
+    }
+}
@@ -0,0 +1,120 @@
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <propertyutils.h>
+#include <propertybinary.h>
+#include <string>
+#include <vector>
+
+using Catch::Matchers::Equals;
+
+typedef PropertyValue PV ;
+
+static void setupBinaryProperties(Properties& properties) {
+    properties.put("boolValue", PV(true));
+    properties.put("longValue", PV(-689876));
+    properties.put("floatValue", PV(-12.6f));
+    properties.put("charValue", PV("string value"));
+    properties.put("longString", PV("a string value that is longer than 31 characters"));
+}
+
+TEST_CASE("Binary Properties", "[properties][binary]") {
+    Properties properties;
+    setupBinaryProperties(properties);
+    std::vector<uint8_t> buffer(propertiesBinarySize(properties));
+    REQUIRE(serializePropertiesBinary(buffer.data(), buffer.size(), properties) == buffer.size());
+
+    SECTION("Should round trip all types") {
+        Properties restored;
+        REQUIRE(deserializePropertiesBinary(buffer.data(), buffer.size(), restored));
+        REQUIRE(restored.size() == 5);
+        REQUIRE((bool)restored.get("boolValue") == true);
+        REQUIRE((long)restored.get("longValue") == -689876);
+        REQUIRE((float)restored.get("floatValue") == Approx(-12.6));
+        REQUIRE_THAT((const char*)restored.get("charValue"), Equals("string value"));
+        REQUIRE_THAT((const char*)restored.get("longString"), Equals("a string value that is longer than 31 characters"));
+    }
+
+    SECTION("Should round trip through a stream") {
+        Stream out;
+        REQUIRE(serializePropertiesBinary(out, properties));
+        Stream in(out.streamedOut());
+        Properties restored;
+        REQUIRE(deserializePropertiesBinary(in, restored));
+        REQUIRE((long)restored.get("longValue") == -689876);
+    }
+
+    SECTION("Should not serialize into a to small buffer") {
+        REQUIRE(serializePropertiesBinary(buffer.data(), buffer.size() - 1, properties) == 0);
+    }
+
+    SECTION("Should reject any corruption without touching properties") {
+        for (size_t i = 0; i < buffer.size(); i++) {
+            std::vector<uint8_t> corrupted(buffer);
+            corrupted[i] ^= 0x10;
+            Properties restored;
+            restored.put("keep", PV(1));
+            REQUIRE(deserializePropertiesBinary(corrupted.data(), corrupted.size(), restored) == false);
+            REQUIRE(restored.size() == 1);
+        }
+    }
+
+    SECTION("Should reject truncated data") {
+        for (size_t i = 0; i < buffer.size(); i++) {
+            Properties restored;
+            REQUIRE(deserializePropertiesBinary(buffer.data(), i, restored) == false);
+            REQUIRE(restored.size() == 0);
+        }
+    }
+
+    SECTION("Should reject text format") {
+        Stream in("longValue=L689876\n");
+        Properties restored;
+        REQUIRE(deserializePropertiesBinary(in, restored) == false);
+    }
+}
+
+TEST_CASE("Properties load and save throughput", "[!benchmark][properties][binary]") {
+    Properties properties;
+    char name[16];
+
+    for (int i = 0; i < 10; i++) {
+        snprintf(name, sizeof(name), "long%d", i);
+        properties.put(name, PV((int32_t)i * 1000));
+        snprintf(name, sizeof(name), "string%d", i);
+        properties.put(name, PV("DOORBELL/status"));
+    }
+
+    Stream textOut;
+    serializeProperties<32>(textOut, properties);
+    std::string text = textOut.streamedOut();
+    std::vector<uint8_t> binary(propertiesBinarySize(properties));
+    serializePropertiesBinary(binary.data(), binary.size(), properties);
+
+    BENCHMARK("Save text") {
+        Stream out;
+        serializeProperties<32>(out, properties);
+    }
+
+    BENCHMARK("Save binary") {
+        Stream out;
+        serializePropertiesBinary(out, properties);
+    }
+
+    BENCHMARK("Load text") {
+        Properties restored;
+        Stream in(text);
+        deserializeProperties<32>(in, restored);
+    }
+
+    BENCHMARK("Load binary") {
+        Properties restored;
+        Stream in(std::string(binary.begin(), binary.end()));
+        deserializePropertiesBinary(in, restored);
+    }
+
+    BENCHMARK("Load binary from buffer") {
+        Properties restored;
+        deserializePropertiesBinary(binary.data(), binary.size(), restored);
+    }
+}
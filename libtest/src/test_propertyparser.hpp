@@ -0,0 +1,138 @@
+#include <catch2/catch.hpp>
+
+#include <memory>
+#include <propertyutils.h>
+#include <string>
+#include <vector>
+
+using Catch::Matchers::Equals;
+
+typedef PropertyValue PV ;
+
+static size_t parseText(const std::string& p_text, Properties& p_properties, std::vector<PropertiesParseError>* p_errors = nullptr) {
+    // Copy into a buffer without null termination, just like a file read
+    std::vector<char> buffer(p_text.begin(), p_text.end());
+    return deserializeProperties(buffer.data(), buffer.size(), p_properties, [p_errors](const PropertiesParseError & error) {
+        if (p_errors != nullptr) {
+            p_errors->push_back(error);
+        }
+    });
+}
+
+TEST_CASE("Properties parser from buffer", "[properties][parser]") {
+    Properties properties;
+
+    SECTION("Should read all types") {
+        REQUIRE(parseText("boolValue  =    B  1\n"
+                          "charValue=Sstring value\n"
+                          "floatValue=F-12.6\n"
+                          "longValue=L689876", properties) == 0);
+        REQUIRE((bool)properties.get("boolValue") == true);
+        REQUIRE((float)properties.get("floatValue") == Approx(-12.6));
+        REQUIRE((long)properties.get("longValue") == 689876);
+        REQUIRE_THAT((const char*)properties.get("charValue"), Equals("string value"));
+    }
+
+    SECTION("Should read what serializeProperties writes") {
+        Properties source;
+        source.put("boolValue", PV(false));
+        source.put("charValue", PV("value with = sign"));
+        source.put("floatValue", PV(0.25f));
+        source.put("longValue", PV(-5));
+        Stream stream;
+        serializeProperties<64>(stream, source);
+        REQUIRE(parseText(stream.streamedOut(), properties) == 0);
+        REQUIRE((bool)properties.get("boolValue") == false);
+        REQUIRE_THAT((const char*)properties.get("charValue"), Equals("value with = sign"));
+        REQUIRE((float)properties.get("floatValue") == Approx(0.25));
+        REQUIRE((long)properties.get("longValue") == -5);
+    }
+
+    SECTION("Should read lines of any length") {
+        std::string longValue(500, 'x');
+        REQUIRE(parseText("stringValue=S" + longValue + "\r\n", properties) == 0);
+        REQUIRE_THAT((const char*)properties.get("stringValue"), Equals(longValue));
+    }
+
+    SECTION("Should skip empty lines and keep empty strings") {
+        REQUIRE(parseText("\n   \n\nempty=S\n\n", properties) == 0);
+        REQUIRE(properties.size() == 1);
+        REQUIRE_THAT((const char*)properties.get("empty"), Equals(""));
+    }
+
+    SECTION("Should report errors with line numbers") {
+        std::vector<PropertiesParseError> errors;
+        REQUIRE(parseText("first=L1\n"
+                          "no separator\n"
+                          " = L3\n"
+                          "unknown=X4\n"
+                          "invalid=L12abc\n"
+                          "missing=\n"
+                          "last=L7", properties, &errors) == 5);
+        REQUIRE(errors.size() == 5);
+        REQUIRE(errors[0].line == 2);
+        REQUIRE(errors[0].reason == PropertiesParseError::MISSING_SEPARATOR);
+        REQUIRE(errors[1].line == 3);
+        REQUIRE(errors[1].reason == PropertiesParseError::EMPTY_NAME);
+        REQUIRE(errors[2].line == 4);
+        REQUIRE(errors[2].reason == PropertiesParseError::UNKNOWN_TYPE);
+        REQUIRE(errors[3].line == 5);
+        REQUIRE(errors[3].reason == PropertiesParseError::INVALID_NUMBER);
+        REQUIRE(errors[4].line == 6);
+        REQUIRE(errors[4].reason == PropertiesParseError::UNKNOWN_TYPE);
+        REQUIRE(properties.size() == 2);
+        REQUIRE((long)properties.get("last") == 7);
+    }
+}
+
+TEST_CASE("Properties index while parsing sorted text", "[properties][parser]") {
+    Properties properties;
+    std::string text;
+    char line[16];
+
+    // Sorted like serializeProperties writes it, more keys than the index holds
+    for (int i = 0; i < PROPERTIES_INDEX_SIZE + 8; i++) {
+        snprintf(line, sizeof(line), "k%03d=L%d\n", i, i);
+        text += line;
+    }
+
+    REQUIRE(parseText(text, properties) == 0);
+
+    SECTION("Should index appended keys and find the keys after a full index by name") {
+        REQUIRE((long)properties.get(PropertyKey("k000")) == 0);
+        REQUIRE((long)properties.get(PropertyKey("k031")) == 31);
+        REQUIRE((long)properties.get(PropertyKey("k039")) == PROPERTIES_INDEX_SIZE + 7);
+        REQUIRE_FALSE(properties.contains(PropertyKey("k040")));
+    }
+
+    SECTION("Should find appended keys after an insert in the middle") {
+        properties.put("k0155", PV(155));
+        properties.put("k100", PV(100));
+        properties.put("k101", PV(101));
+        REQUIRE((long)properties.get(PropertyKey("k0155")) == 155);
+        REQUIRE((long)properties.get(PropertyKey("k016")) == 16);
+        REQUIRE((long)properties.get(PropertyKey("k101")) == 101);
+    }
+}
+
+TEST_CASE("Properties parser throughput", "[!benchmark][properties][parser]") {
+    std::string text;
+    char line[64];
+
+    for (int i = 0; i < 1000; i++) {
+        snprintf(line, sizeof(line), "key%04d=L%d\nname%04d=SDOORBELL/status\n", i, i, i);
+        text += line;
+    }
+
+    BENCHMARK("Stream, 2000 lines") {
+        Properties properties;
+        Stream stream(text);
+        deserializeProperties<32>(stream, properties);
+    }
+
+    BENCHMARK("Buffer, 2000 lines") {
+        Properties properties;
+        std::vector<char> buffer(text.begin(), text.end());
+        deserializeProperties(buffer.data(), buffer.size(), properties);
+    }
+}
@@ -0,0 +1,144 @@
+#include <catch2/catch.hpp>
+
+#include <ringer.h>
+#include <spscqueue.h>
+
+TEST_CASE("Single producer single consumer queue", "[ringer]") {
+    SpscQueue<uint32_t, 4> queue;
+    uint32_t item;
+
+    SECTION("Should keep order") {
+        REQUIRE(queue.empty());
+        REQUIRE(queue.push(1));
+        REQUIRE(queue.push(2));
+        REQUIRE(queue.size() == 2);
+        REQUIRE(queue.pop(item));
+        REQUIRE(item == 1);
+        REQUIRE(queue.pop(item));
+        REQUIRE(item == 2);
+        REQUIRE_FALSE(queue.pop(item));
+    }
+
+    SECTION("Should count overflows and wrap") {
+        for (uint32_t i = 0; i < 1000; i++) {
+            REQUIRE(queue.push(i));
+            REQUIRE(queue.pop(item));
+            REQUIRE(item == i);
+        }
+
+        for (uint32_t i = 0; i < 6; i++) {
+            queue.push(i);
+        }
+
+        REQUIRE(queue.size() == 4);
+        REQUIRE(queue.overflows() == 2);
+    }
+}
+
+TEST_CASE("Ringer", "[ringer]") {
+    Ringer ringer;
+    ringer.post(Ringer::RINGER_ENABLE, 1);
+    ringer.post(Ringer::RINGER_MAX_TIME, 5000);
+
+    // Returns the number of ticks the relay was on
+    auto ticks = [&ringer](uint32_t p_count) {
+        uint32_t on = 0;
+
+        for (uint32_t i = 0; i < p_count; i++) {
+            on += ringer.tick();
+        }
+
+        return on;
+    };
+
+    SECTION("Should ring while pressed") {
+        ticks(10);
+        ringer.post(Ringer::RINGER_PRESS);
+        REQUIRE(ticks(100) == 100);
+        ringer.post(Ringer::RINGER_RELEASE);
+        REQUIRE(ticks(100) == 0);
+        REQUIRE(ringer.rings() == 1);
+        REQUIRE(ringer.lastDuration() == 100);
+        REQUIRE(ringer.lastLatency() == 1000);
+        REQUIRE(ringer.truncated() == 0);
+    }
+
+    SECTION("Should ring at once on a button change from the interrupt") {
+        ticks(10);
+        ringer.button(true, 5300);
+        REQUIRE(ringer.lastLatency() == 5300);
+        REQUIRE(ticks(100) == 100);
+        ringer.button(false, 5000);
+        REQUIRE(ticks(100) == 0);
+        REQUIRE(ringer.lastDuration() == 100);
+
+        ringer.post(Ringer::RINGER_PRESS, 20000);
+        ticks(1);
+        REQUIRE(ringer.lastLatency() == 21000);
+        REQUIRE(ringer.maxLatency() == 21000);
+    }
+
+    SECTION("Should stop at the max ring time without the loop") {
+        ringer.post(Ringer::RINGER_PRESS);
+        REQUIRE(ticks(10000) == 5000);
+        REQUIRE_FALSE(ringer.relay());
+        REQUIRE(ringer.truncated() == 1);
+        REQUIRE(ringer.lastDuration() == 5000);
+
+        // A new ring needs a new press
+        ringer.post(Ringer::RINGER_RELEASE);
+        ringer.post(Ringer::RINGER_PRESS);
+        REQUIRE(ticks(10) == 10);
+    }
+
+    SECTION("Should follow the cadence") {
+        ringer.post(Ringer::RINGER_CADENCE, (100 << 16) | 50);
+        ringer.post(Ringer::RINGER_PRESS);
+        REQUIRE(ticks(100) == 100);
+        REQUIRE(ticks(50) == 0);
+        REQUIRE(ticks(150) == 100);
+    }
+
+    SECTION("Should not ring when disabled") {
+        ringer.post(Ringer::RINGER_PRESS);
+        ticks(10);
+        ringer.post(Ringer::RINGER_ENABLE, 0);
+        REQUIRE(ticks(10) == 0);
+        ringer.post(Ringer::RINGER_RELEASE);
+        ringer.post(Ringer::RINGER_PRESS);
+        REQUIRE(ticks(10) == 0);
+        REQUIRE(ringer.rings() == 1);
+    }
+
+    SECTION("Should only post changed settings and retry what did not fit") {
+        ticks(1);
+        REQUIRE(ringer.configure(true, 5000, 100, 50));
+        ticks(1);
+
+        // Nothing changed, nothing posted
+        for (uint8_t i = 0; i < RINGER_MAILBOX_SIZE; i++) {
+            REQUIRE(ringer.configure(true, 5000, 100, 50));
+        }
+
+        REQUIRE(ringer.mailboxOverflows() == 0);
+
+        for (uint8_t i = 0; i < RINGER_MAILBOX_SIZE - 1; i++) {
+            ringer.post(Ringer::RINGER_RELEASE);
+        }
+
+        REQUIRE_FALSE(ringer.configure(true, 200, 0, 0));
+        ticks(1);
+        REQUIRE(ringer.configure(true, 200, 0, 0));
+        ticks(1);
+        ringer.post(Ringer::RINGER_PRESS);
+        REQUIRE(ticks(1000) == 200);
+    }
+
+    SECTION("Should report a full mailbox") {
+        for (uint8_t i = 0; i < RINGER_MAILBOX_SIZE; i++) {
+            ringer.post(Ringer::RINGER_MAX_TIME, 5000);
+        }
+
+        REQUIRE(ringer.mailboxOverflows() == 2);
+    }
+}
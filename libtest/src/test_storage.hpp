@@ -0,0 +1,135 @@
+#include <catch2/catch.hpp>
+
+#include <cachedstorage.h>
+#include <timedstorage.h>
+#include <configjournal.h>
+#include "memorystorage.hpp"
+
+TEST_CASE("Cached storage", "[storage]") {
+    MemoryStorage memory;
+    CachedStorage storage(memory);
+    const uint8_t data[] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+    SECTION("Should only query metadata once") {
+        REQUIRE(storage.exists("a") == false);
+        REQUIRE(storage.size("a") == 0);
+        uint32_t calls = memory.m_metadataCalls;
+
+        REQUIRE(storage.write("a", data, 4) == 4);
+        REQUIRE(storage.append("a", data, 4) == 4);
+        REQUIRE(storage.exists("a"));
+        REQUIRE(storage.size("a") == 8);
+        REQUIRE(memory.m_metadataCalls == calls);
+        REQUIRE(storage.hits() > storage.misses());
+    }
+
+    SECTION("Should follow removes") {
+        storage.write("a", data, sizeof(data));
+        REQUIRE(storage.remove("a"));
+        REQUIRE(storage.exists("a") == false);
+        REQUIRE(memory.exists("a") == false);
+        REQUIRE(storage.remove("a") == false);
+    }
+
+    SECTION("Should read through") {
+        storage.write("a", data, sizeof(data));
+        uint8_t buffer[8];
+        REQUIRE(storage.read("a", 2, buffer, 4) == 4);
+        REQUIRE(buffer[0] == 3);
+        REQUIRE(storage.read("b", 0, buffer, 4) == 0);
+    }
+
+    SECTION("Should replace the oldest entry when full") {
+        const char* names[] = {"a", "b", "c", "d", "e"};
+
+        for (const char* name : names) {
+            storage.write(name, data, 1);
+        }
+
+        REQUIRE(storage.size("e") == 1);
+        uint32_t misses = storage.misses();
+        REQUIRE(storage.size("a") == 1);
+        REQUIRE(storage.misses() == misses + 1);
+    }
+
+    SECTION("Should forget metadata of failed writes") {
+        storage.write("a", data, sizeof(data));
+        memory.m_powerBudget = 3;
+        REQUIRE(storage.append("a", data, sizeof(data)) == 3);
+        memory.reboot();
+        REQUIRE(storage.size("a") == sizeof(data) + 3);
+    }
+}
+
+TEST_CASE("Timed storage", "[storage]") {
+    MemoryStorage memory;
+    memory.m_operationCost = 400;
+    memory.m_byteCost = 20;
+    memory.m_metadataCost = 150;
+    TimedStorage storage(memory, [&memory]() {
+        return memory.m_micros;
+    });
+    const uint8_t data[] = {1, 2, 3, 4};
+
+    storage.write("a", data, sizeof(data));
+    storage.append("a", data, 2);
+    storage.append("a", data, 1);
+    storage.size("a");
+
+    REQUIRE(storage.stats(TimedStorage::WRITE).count == 1);
+    REQUIRE(storage.stats(TimedStorage::WRITE).max == 480);
+    REQUIRE(storage.stats(TimedStorage::APPEND).count == 2);
+    REQUIRE(storage.stats(TimedStorage::APPEND).total == 440 + 420);
+    REQUIRE(storage.stats(TimedStorage::APPEND).max == 440);
+    REQUIRE(storage.stats(TimedStorage::METADATA).total == 150);
+    storage.flush();
+    REQUIRE(storage.stats(TimedStorage::FLUSH).count == 1);
+    REQUIRE(memory.m_flushes == 1);
+    storage.reset();
+    REQUIRE(storage.stats(TimedStorage::APPEND).count == 0);
+}
+
+TEST_CASE("Config journal on cached storage", "[storage][journal]") {
+    MemoryStorage memory;
+    CachedStorage storage(memory);
+    ConfigJournal journal(storage, "c.a", "c.b", "c.jnl", 128);
+    Properties properties;
+    Properties loaded;
+    journal.load(loaded);
+    properties.put("ringerOn", PropertyValue(true));
+    properties.put("mqttServer", PropertyValue("mqtt.home.example.org"));
+    journal.save(properties);
+    uint32_t calls = memory.m_metadataCalls;
+
+    for (int i = 0; i < 50; i++) {
+        properties.put("ringerOn", PropertyValue(i % 2 == 0));
+        REQUIRE(journal.save(properties));
+    }
+
+    // Only files that were never seen need a lookup
+    REQUIRE(memory.m_metadataCalls - calls <= 2);
+
+    Properties reloaded;
+    ConfigJournal reboot(memory, "c.a", "c.b", "c.jnl", 128);
+    REQUIRE(reboot.load(reloaded));
+    REQUIRE((bool)reloaded.get("ringerOn") == false);
+}
+
+TEST_CASE("Storage metadata cost", "[!benchmark][storage]") {
+    MemoryStorage memory;
+    CachedStorage cached(memory);
+    const uint8_t data[] = {1, 2, 3, 4};
+    memory.write("a", data, sizeof(data));
+
+    BENCHMARK("MemoryStorage size") {
+        for (int i = 0; i < 1000; i++) {
+            memory.size("a");
+        }
+    }
+
+    BENCHMARK("CachedStorage size") {
+        for (int i = 0; i < 1000; i++) {
+            cached.size("a");
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#include <catch2/catch.hpp>
+
+#include <taskscheduler.h>
+#include <string>
+
+TEST_CASE("Task scheduler", "[taskscheduler]") {
+    uint32_t micros = 0;
+    uint32_t now = 0;
+    std::string order;
+    TaskScheduler scheduler(5000, [&micros]() {
+        return micros;
+    });
+
+    auto task = [&](char p_name, uint32_t p_cost) {
+        return [&, p_name, p_cost]() {
+            order += p_name;
+            micros += p_cost;
+        };
+    };
+
+    SECTION("Should run tasks at their period") {
+        scheduler.add("a", 100, 1, 100, 1000, task('a', 100));
+        scheduler.add("b", 200, 1, 100, 1000, task('b', 100));
+
+        for (now = 0; now < 400; now += 20) {
+            scheduler.run(now);
+        }
+
+        REQUIRE(scheduler.stats(0).runs == 4);
+        REQUIRE(scheduler.stats(1).runs == 2);
+        REQUIRE(scheduler.stats(0).deadlineMisses == 0);
+    }
+
+    SECTION("Should run by priority") {
+        scheduler.add("low", 100, 1, 100, 1000, task('l', 100));
+        scheduler.add("high", 100, 5, 100, 1000, task('h', 100));
+        scheduler.run(0);
+        REQUIRE(order == "hl");
+    }
+
+    SECTION("Should run pending tasks every frame") {
+        bool pending = false;
+        scheduler.add("mqtt", 200, 5, 100, 1000, task('m', 100), [&pending]() {
+            return pending;
+        });
+
+        for (now = 0; now < 200; now += 20) {
+            pending = now >= 100 && now < 160;
+            scheduler.run(now);
+        }
+
+        // First run, then 100, 120 and 140 ms
+        REQUIRE(scheduler.stats(0).runs == 4);
+    }
+
+    SECTION("Should defer tasks that do not fit in the frame budget") {
+        scheduler.add("slow", 100, 5, 1000, 4000, task('s', 4000));
+        scheduler.add("other", 100, 1, 1000, 2000, task('o', 2000));
+        REQUIRE(scheduler.run(0) == 1);
+        REQUIRE(scheduler.run(20) == 1);
+        REQUIRE(order == "so");
+    }
+
+    SECTION("Should run tasks past their deadline regardless of the budget") {
+        scheduler.add("slow", 20, 5, 1000, 4000, task('s', 4000));
+        scheduler.add("other", 100, 1, 30, 2000, task('o', 2000));
+
+        for (now = 0; now < 200; now += 20) {
+            scheduler.run(now);
+        }
+
+        // Deferred at 0 and 20 ms, forced at 40 ms
+        REQUIRE(scheduler.stats(1).runs >= 2);
+        REQUIRE(scheduler.stats(1).deadlineMisses == scheduler.stats(1).runs);
+    }
+
+    SECTION("Should keep execution time statistics") {
+        scheduler.add("a", 20, 1, 100, 500, task('a', 300));
+        scheduler.run(0);
+        scheduler.run(20);
+        REQUIRE(scheduler.stats(0).runs == 2);
+        REQUIRE(scheduler.stats(0).total == 600);
+        REQUIRE(scheduler.stats(0).max == 300);
+        REQUIRE(scheduler.stats(0).overruns == 0);
+        REQUIRE(std::string(scheduler.name(0)) == "a");
+        REQUIRE(std::string(scheduler.longestTask()) == "a");
+        REQUIRE(scheduler.longestTaskTime() == 300);
+        scheduler.resetStats();
+        REQUIRE(scheduler.stats(0).runs == 0);
+    }
+}
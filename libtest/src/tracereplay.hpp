@@ -0,0 +1,192 @@
+#pragma once
+
+#include "arduinostubs.hpp"
+
+#include <inputtrace.h>
+#include <digitalknob.h>
+#include <initializer_list>
+
+/**
+ * Synthetic button presses with contact bounce and noise spikes, written into an InputTrace
+ * The same seed gives the same presses
+ */
+class BounceGenerator {
+private:
+    uint32_t m_seed;
+
+public:
+    // Up to m_bounces extra edges after each change, each up to m_bounceTime us
+    uint8_t m_bounces = 6;
+    uint16_t m_bounceTime = 1500;
+    // Mean us between noise spikes, 0 for no noise, each spike up to m_noiseTime us
+    uint32_t m_noiseInterval = 0;
+    uint16_t m_noiseTime = 500;
+
+    BounceGenerator(uint32_t p_seed) : m_seed(p_seed) {
+    }
+
+    /**
+     * 0..p_max - 1, xorshift32
+     */
+    uint32_t random(uint32_t p_max) {
+        m_seed ^= m_seed << 13;
+        m_seed ^= m_seed >> 17;
+        m_seed ^= m_seed << 5;
+        return m_seed % p_max;
+    }
+
+    uint32_t random(uint32_t p_min, uint32_t p_max) {
+        return p_min + random(p_max - p_min + 1);
+    }
+
+    /**
+     * Record p_pattern in p_trace from p_time in us, durations in ms, pressed and released alternating starting with pressed
+     * Returns the time in us after the pattern
+     */
+    uint32_t generate(InputTrace& p_trace, uint32_t p_time, std::initializer_list<uint16_t> p_pattern) {
+        bool level = true;
+
+        for (uint16_t duration : p_pattern) {
+            uint32_t end = p_time + duration * 1000UL;
+            uint32_t time = p_time;
+
+            // The contact bounces, ending at the new level
+            for (uint8_t bounces = random(m_bounces + 1) & ~1; bounces > 0; bounces--) {
+                p_trace.record(bounces % 2 ? !level : level, time);
+                time += random(50, m_bounceTime);
+            }
+
+            p_trace.record(level, time);
+
+            while (m_noiseInterval > 0) {
+                time += random(m_noiseInterval * 2);
+
+                if (time + m_noiseTime >= end) {
+                    break;
+                }
+
+                p_trace.record(!level, time);
+                time += random(50, m_noiseTime);
+                p_trace.record(level, time);
+            }
+
+            p_time = end;
+            level = !level;
+        }
+
+        return p_time;
+    }
+};
+
+/**
+ * Feed p_trace through p_knob every p_tickPeriod ms, millis() is p_millis at the start of the trace
+ * p_tick is the time in us from the start of the trace of the first tick, returns the time of the next tick
+ */
+inline uint32_t replay(const InputTrace& p_trace, DigitalKnob& p_knob, uint16_t p_tickPeriod, uint32_t p_tick = 0,
+                       uint32_t p_millis = 0) {
+    p_trace.forEach([&](bool p_level, uint32_t p_start, uint32_t p_duration) {
+        digitalReadStubbed = p_level;
+
+        for (; p_tick < p_start + p_duration; p_tick += p_tickPeriod * 1000UL) {
+            millisStubbed = p_millis + p_tick / 1000;
+            p_knob.handle();
+        }
+    });
+
+    return p_tick;
+}
+
+/**
+ * Generates presses, replays them through a DigitalKnob and scores what the knob detected
+ */
+class TraceScorer {
+public:
+    uint32_t m_presses = 0;
+    // Presses detected as the type that was generated
+    uint32_t m_correct = 0;
+    // Presses without an edge up
+    uint32_t m_missed = 0;
+    // Extra edges up during a press or the release after it, noise that passed the filter
+    uint32_t m_falseEdges = 0;
+    // ms from the start of a press until its edge up
+    uint64_t m_latencySum = 0;
+    uint32_t m_maxLatency = 0;
+
+    BounceGenerator m_generator;
+
+    TraceScorer(uint32_t p_seed) : m_generator(p_seed), m_trace(100), m_millis(0), m_tick(0) {
+    }
+
+    /**
+     * Generate p_count presses of p_type with timing the masks of DigitalKnob accept and score p_knob handled every p_tickPeriod ms
+     */
+    void score(DigitalKnob& p_knob, uint16_t p_tickPeriod, PressEvent::Type p_type, uint32_t p_count) {
+        for (uint32_t i = 0; i < p_count; i++) {
+            // Each press is a trace from 0us, m_millis keeps the time of the knob going
+            m_trace.start(false, 0);
+            uint32_t end;
+
+            switch (p_type) {
+                case PressEvent::DOUBLE:
+                    end = m_generator.generate(m_trace, 0, {
+                        (uint16_t)m_generator.random(100, 140), (uint16_t)m_generator.random(240, 280),
+                        (uint16_t)m_generator.random(100, 140), 800
+                    });
+                    break;
+
+                case PressEvent::LONG:
+                    end = m_generator.generate(m_trace, 0, {(uint16_t)m_generator.random(1000, 1500), 800});
+                    break;
+
+                default:
+                    end = m_generator.generate(m_trace, 0, {(uint16_t)m_generator.random(160, 220), 800});
+                    break;
+            }
+
+            m_trace.stop(end);
+            // Ticks keep their own pace, so presses start at any time between two ticks
+            m_tick = replay(m_trace, p_knob, p_tickPeriod, m_tick, m_millis) - end;
+            check(p_knob, p_type, p_type == PressEvent::DOUBLE ? 2 : 1, m_millis);
+            m_millis += end / 1000;
+        }
+    }
+
+    double accuracy() const {
+        return m_presses == 0 ? 0 : (double)m_correct / m_presses;
+    }
+
+    double averageLatency() const {
+        return m_presses == m_missed ? 0 : (double)m_latencySum / (m_presses - m_missed);
+    }
+
+private:
+    InputTrace m_trace;
+    // millis() at the start of the next press and the us from there to the next tick
+    uint32_t m_millis;
+    uint32_t m_tick;
+
+    void check(DigitalKnob& p_knob, PressEvent::Type p_type, uint8_t p_edges, uint32_t p_pressStart) {
+        PressEvent events[DIGITAL_INPUT_EVENTS];
+        uint8_t count = p_knob.events(events, DIGITAL_INPUT_EVENTS);
+        uint8_t edgeUp = 0;
+        uint8_t detected = 0;
+        bool correct = false;
+
+        for (uint8_t i = 0; i < count; i++) {
+            if (events[i].m_type == PressEvent::EDGE_UP && edgeUp >= p_edges) {
+                m_falseEdges++;
+            } else if (events[i].m_type == PressEvent::EDGE_UP && edgeUp++ == 0) {
+                uint32_t latency = events[i].m_start - p_pressStart;
+                m_latencySum += latency;
+                m_maxLatency = latency > m_maxLatency ? latency : m_maxLatency;
+            } else if (events[i].m_type >= PressEvent::SINGLE) {
+                detected++;
+                correct = events[i].m_type == p_type;
+            }
+        }
+
+        m_presses++;
+        m_missed += edgeUp == 0;
+        m_correct += detected == 1 && correct;
+    }
+};
@@ -1,5 +1,7 @@
 #pragma once
 #include <iostream>
+#include <algorithm>
+#include <stdint.h>
 class Stream {
     std::string m_allIn;
     std::string m_allOut;
@@ -19,6 +21,11 @@ public:
         std::cout << f << "\n";
     }
 
+    size_t write(const uint8_t* buffer, size_t size) {
+        m_allIn.append(reinterpret_cast<const char*>(buffer), size);
+        return size;
+    }
+
     std::string streamedOut() const {
         return m_allIn;
     }
@@ -48,6 +55,17 @@ public:
         }
     }
 
+    size_t readBytes(char* buffer, size_t length) {
+        size_t size = std::min(length, m_allOut.size());
+        m_allOut.copy(buffer, size);
+        m_allOut.erase(0, size);
+        return size;
+    }
+
+    size_t readBytes(uint8_t* buffer, size_t length) {
+        return readBytes(reinterpret_cast<char*>(buffer), length);
+    }
+
     int peek() {
         return m_allOut[0];
     }
@@ -1,7 +1,6 @@
 // How often we are updating the mqtt state in ms
 
-constexpr char MQTT_STATUS[] =                           "status";
-constexpr char  MQTT_LASTWILL_TOPIC[] =                    "lastwill";
+// MQTT_STATUS and MQTT_LASTWILL_TOPIC are in controllersettings.h, the derived topics are build from them
 constexpr char  MQTT_LASTWILL_ONLINE[] =                   "online";
 constexpr char  MQTT_LASTWILL_OFFLINE[] =                  "offline";
 
@@ -10,5 +9,34 @@ constexpr uint8_t RINGER_PIN = 14;  // D5
 constexpr uint8_t LED_PIN = 2;
 constexpr bool INVERT_OUTPUT = false;
 constexpr bool INVERT_INPUT = true;
+// Capture button edges with a pin change interrupt instead of polling the button every frame
+constexpr bool BUTTON_EDGE_CAPTURE = true;
+// Time in us the button must be stable before a press or release is accepted
+// It is the start value, the debounce time adapts within debounceMinTime and debounceMaxTime
+constexpr uint32_t BUTTON_DEBOUNCE_TIME = 10000;
+// Resolution in us of a raw trace of the button and the longest trace in ms, see DOORBELL/trace
+constexpr uint16_t BUTTON_TRACE_RESOLUTION = 100;
+constexpr uint32_t BUTTON_TRACE_MAX_TIME = 60000;
+// Presses of this many ms or longer are long presses in a gesture
+constexpr uint16_t GESTURE_LONG_PRESS = 400;
+// A release of this many ms ends a gesture
+constexpr uint16_t GESTURE_GAP = 300;
 
 constexpr char   CONFIG_FILENAME[] = "doorbell.conf";
+constexpr char   CONFIG_SLOT_A_FILENAME[] = "doorbell.a";
+constexpr char   CONFIG_SLOT_B_FILENAME[] = "doorbell.b";
+constexpr char   CONFIG_JOURNAL_FILENAME[] = "doorbell.jnl";
+// Journal size in bytes after which a new snapshot is written
+constexpr size_t CONFIG_JOURNAL_COMPACT_SIZE = 512;
+// Time in ms without changes before the configuration is written
+constexpr uint32_t CONFIG_WRITE_QUIET_WINDOW = 30000;
+// Maximum number of configuration writes per fixed 24 hour window, critical changes are always written
+constexpr uint16_t CONFIG_WRITES_PER_DAY = 48;
+// Maximum time in us a frame spends writing the configuration, at least one small chunk is written per frame
+constexpr uint32_t CONFIG_SAVE_STEP_BUDGET = 2000;
+// Time in us per frame for maintenance tasks, a task that does not fit waits for a later frame
+constexpr uint32_t TASK_FRAME_BUDGET = 8000;
+// How often the execution time of the maintenance tasks is published in ms
+constexpr uint32_t TASK_STATS_PERIOD = 60000;
+// Timer1 ticks at 80MHz / 16, 5000 ticks is the 1ms tick of the ringer
+constexpr uint32_t RINGER_TIMER_TICKS = 5000;
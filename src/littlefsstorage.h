@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string.h>
+#include <storage.h>
+#include "LittleFS.h"
+
+/**
+ * Storage on top of LittleFS, mount it once with begin()
+ * The file that was appended to last stays open so consecutive appends, like the chunks of a
+ * journal frame, do not pay for opening the file again. Appends are committed by flush() or when the
+ * file is closed, so a save flushes once per step instead of once per chunk.
+ */
+class LittleFSStorage : public Storage {
+private:
+    bool m_mounted = false;
+    File m_appendFile;
+    const char* m_appendName = nullptr;
+
+public:
+    bool begin() {
+        if (!m_mounted) {
+            m_mounted = LittleFS.begin();
+        }
+
+        return m_mounted;
+    }
+
+    bool mounted() const {
+        return m_mounted;
+    }
+
+    virtual bool exists(const char* p_name) {
+        return m_mounted && LittleFS.exists(p_name);
+    }
+
+    virtual size_t size(const char* p_name) {
+        if (!exists(p_name)) {
+            return 0;
+        }
+
+        closeAppend(p_name);
+        File file = LittleFS.open(p_name, "r");
+        size_t size = file ? file.size() : 0;
+        file.close();
+        return size;
+    }
+
+    virtual size_t read(const char* p_name, size_t p_offset, uint8_t* p_buffer, size_t p_length) {
+        if (!m_mounted) {
+            return 0;
+        }
+
+        closeAppend(p_name);
+        File file = LittleFS.open(p_name, "r");
+        size_t length = 0;
+
+        if (file && file.seek(p_offset)) {
+            length = file.read(p_buffer, p_length);
+        }
+
+        file.close();
+        return length;
+    }
+
+    virtual size_t write(const char* p_name, const uint8_t* p_buffer, size_t p_length) {
+        if (!m_mounted) {
+            return 0;
+        }
+
+        closeAppend(p_name);
+        File file = LittleFS.open(p_name, "w");
+        size_t length = 0;
+
+        if (file) {
+            length = file.write(p_buffer, p_length);
+        }
+
+        file.close();
+        return length;
+    }
+
+    virtual size_t append(const char* p_name, const uint8_t* p_buffer, size_t p_length) {
+        if (!m_mounted) {
+            return 0;
+        }
+
+        if (m_appendName == nullptr || strcmp(m_appendName, p_name) != 0) {
+            closeAppend(m_appendName);
+            m_appendFile = LittleFS.open(p_name, "a");
+            m_appendName = p_name;
+        }
+
+        size_t length = 0;
+
+        if (m_appendFile) {
+            length = m_appendFile.write(p_buffer, p_length);
+        }
+
+        return length;
+    }
+
+    virtual bool remove(const char* p_name) {
+        if (!m_mounted) {
+            return false;
+        }
+
+        closeAppend(p_name);
+        return LittleFS.remove(p_name);
+    }
+
+    virtual void flush() {
+        if (m_appendName != nullptr && m_appendFile) {
+            m_appendFile.flush();
+        }
+    }
+
+private:
+    void closeAppend(const char* p_name) {
+        if (m_appendName != nullptr && p_name != nullptr && strcmp(m_appendName, p_name) == 0) {
+            m_appendFile.close();
+            m_appendName = nullptr;
+        }
+    }
+};
@@ -3,6 +3,7 @@
 #include <memory>
 #include <cstring>
 #include <vector>
+#include <algorithm>
 
 #include "makestring.h"
 #include "crceeprom.h"
@@ -13,6 +14,20 @@
 #include "LittleFS.h"
 
 #include <propertyutils.h>
+#include <propertybinary.h>
+#include <configjournal.h>
+#include <persistscheduler.h>
+#include <cachedstorage.h>
+#include <timedstorage.h>
+#include "littlefsstorage.h"
+#include <taskscheduler.h>
+#include <frameclock.h>
+#include <profiler.h>
+#include <ringer.h>
+#include <edgecapture.h>
+#include <gestureengine.h>
+#include <inputtrace.h>
+#include <fastpin.h>
 #include <optparser.hpp>
 #include <utils.h>
 
@@ -20,6 +35,7 @@
 
 #include <config.h>
 #include <digitalknob.h>
+#include <controllersettings.h>
 
 #include <statemachine.h>
 
@@ -30,25 +46,64 @@ typedef PropertyValue PV ;
 #define FRAMES_PER_SECOND        50
 #define EFFECT_PERIOD_CALLBACK   (1000 / FRAMES_PER_SECOND)
 
-// of transitions
-volatile uint32_t counter50TimesSec = 1;
-
-// Keep track when the last time we ran the effect state changes
-uint32_t effectPeriodStartMillis = 0;
-
-// start time when the bell starting ringing
-uint32_t bellStartTime = 0;
-
-// Analog and digital inputs
-DigitalKnob digitalKnob(BUTTON_PIN, INVERT_INPUT, 110);
+// Starts the effect frames and measures how late each frame starts, the catch up policy is configurable
+FrameClock frameClock(EFFECT_PERIOD_CALLBACK * 1000, FrameClock::CATCH_UP_BURST);
+
+// Owns the relay, ticked by the timer1 interrupt so max ring time and cadence do not depend on the loop
+Ringer ringer;
+// Settings that did not fit in the mailbox of the ringer, posted again next frame
+bool ringerConfigPending = false;
+
+// Pins accessed in the frame loop and the interrupts, single register operations
+using ButtonPin = FastPin<BUTTON_PIN, INVERT_INPUT>;
+using RingerPin = FastPin<RINGER_PIN, INVERT_OUTPUT>;
+using LedPin = FastPin<LED_PIN>;
+
+// Analog and digital inputs, ButtonPin already inverts the input
+DigitalKnob digitalKnob(BUTTON_PIN, false, 110, EFFECT_PERIOD_CALLBACK, false);
+// Edges of BUTTON_PIN from the pin change interrupt, used instead of polling when BUTTON_EDGE_CAPTURE is set
+// Debounced by the timer1 interrupt that also ticks the ringer, so a press rings without waiting for a frame
+EdgeCapture buttonCapture(false, BUTTON_DEBOUNCE_TIME);
+// Time in us between the first edge of the last press and detecting it in the loop
+uint32_t buttonPressLatency = 0;
+// Raw samples of BUTTON_PIN from the timer1 interrupt while tracing, to tune the debouncer against real wiring
+InputTrace buttonTrace(BUTTON_TRACE_RESOLUTION);
+// millis() the trace stops, 0 when not tracing
+uint32_t buttonTraceEnd = 0;
+// Next entry of the trace to publish once it stopped
+uint16_t buttonTraceEntry = 0;
+bool buttonTracePublishing = false;
+// Press patterns of the button, loaded from the gesture.* properties of controllerConfig
+GestureEngine gestureEngine(EFFECT_PERIOD_CALLBACK, GESTURE_LONG_PRESS, GESTURE_GAP);
 
 // Stores information about the bell
 Properties controllerConfig;
-volatile bool controllerConfigModified = false;
+// Persist, publish or reconnect depending on which keys of controllerConfig changed
+ConfigListeners controllerConfigListeners;
+// Coalesces writes of controllerConfig to flash
+PersistScheduler configWriteScheduler(CONFIG_WRITE_QUIET_WINDOW, CONFIG_WRITES_PER_DAY);
+// Longest saveConfigStep(..) of the save in progress in us
+uint32_t configSaveLongestStep = 0;
+// Snapshot of controllerConfig, rebuild by controllerConfigChanged()
+ControllerSettings controllerSettings;
+// Persists only the changes of controllerConfig
+// LittleFS is mounted once, metadata is cached and every operation is timed
+LittleFSStorage littleFSStorage;
+CachedStorage cachedStorage(littleFSStorage);
+TimedStorage configStorage(cachedStorage, micros);
+ConfigJournal configJournal(configStorage, CONFIG_SLOT_A_FILENAME, CONFIG_SLOT_B_FILENAME, CONFIG_JOURNAL_FILENAME, CONFIG_JOURNAL_COMPACT_SIZE);
 
 // CRC value of last update to MQTT
 volatile uint16_t lastMeasurementCRC = 0;
 
+#ifdef PROFILER
+// Execution time of the sections of loop(), build with -DPROFILER to enable
+Profiler profiler(F_CPU / 1000000);
+#endif
+
+// Maintenance work of the main loop, the button and ringer are handled outside of it every frame
+TaskScheduler taskScheduler(TASK_FRAME_BUDGET, micros);
+
 // Indicate that a service requested an restart. Set to millies() of current time and it will restart 5000ms later
 volatile uint32_t shouldRestart = 0;
 
@@ -79,35 +134,71 @@ WiFiManagerParameter wm_mqtt_password("input", "mqtt password", "", MQTT_PASSWOR
 ///////////////////////////////////////////////////////////////////////////
 
 
+/**
+ * Post the ringer settings that changed, what does not fit in the mailbox is retried by the next frame
+ */
+void configureRinger() {
+    ringerConfigPending = !ringer.configure(controllerSettings.ringerOn, controllerSettings.maxRingTime,
+                                            controllerSettings.ringOnTime, controllerSettings.ringOffTime);
+}
+
+/**
+ * Must be called after each modification of controllerConfig
+ * Rebuilds the settings snapshot, controllerConfigListeners pick up the changed keys in the main loop
+ */
+void controllerConfigChanged() {
+    loadControllerSettings(controllerSettings, controllerConfig);
+    frameClock.catchUp((FrameClock::CatchUp)controllerSettings.frameCatchUp);
+    configureRinger();
+    digitalKnob.adaptiveAlpha(controllerSettings.debounceMinAlpha, controllerSettings.debounceMaxAlpha);
+    buttonCapture.adaptiveDebounce(controllerSettings.debounceMinTime, controllerSettings.debounceMaxTime);
+
+    if (loadGestures(gestureEngine, controllerConfig) == 0) {
+        gestureEngine.add("single", ".");
+        gestureEngine.add("double", "..");
+        gestureEngine.add("long", "-");
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////
 //  LittleFS
 ///////////////////////////////////////////////////////////////////////////
 
 
+/**
+ * Load the binary configuration and journal, when these are missing fallback to the text configuration
+ */
 bool loadConfig(const char* filename, Properties& properties) {
     bool ret = false;
 
-    if (LittleFS.begin()) {
+    if (littleFSStorage.begin()) {
         Serial.println("mounted file system");
+        uint32_t start = micros();
+        ret = configJournal.load(properties);
 
-        if (LittleFS.exists(filename)) {
-            //file exists, reading and loading
-            File configFile = LittleFS.open(filename, "r");
+        if (ret) {
+            Serial.printf("Loaded config slot %u generation %u journal %u bytes in %uus\n",
+                          (unsigned)configJournal.activeSlot(), (unsigned)configJournal.generation(),
+                          (unsigned)configJournal.journalSize(), (unsigned)(micros() - start));
+        }
 
-            if (configFile) {
-                Serial.print(F("Loading config : "));
-                Serial.println(filename);
-                deserializeProperties<32>(configFile, properties);
-                //   serializeProperties<32>(Serial, properties);
+        if (!ret && configStorage.exists(filename)) {
+            Serial.print(F("Loading config : "));
+            Serial.println(filename);
+            // Read the whole file at once and parse it in place
+            size_t size = configStorage.size(filename);
+            std::unique_ptr<char[]> buffer(new char[size]);
+
+            if (configStorage.read(filename, 0, reinterpret_cast<uint8_t*>(buffer.get()), size) == size) {
+                deserializeProperties(buffer.get(), size, properties, [](const PropertiesParseError & error) {
+                    Serial.printf("Config error line %u reason %u\n", (unsigned)error.line, (unsigned)error.reason);
+                });
+                ret = true;
             }
-
-            configFile.close();
-        } else {
+        } else if (!ret) {
             Serial.print(F("File not found: "));
             Serial.println(filename);
         }
-
-        // LittleFS.end();
     } else {
         Serial.print(F("Failed to begin LittleFS"));
     }
@@ -117,33 +208,77 @@ bool loadConfig(const char* filename, Properties& properties) {
 
 
 /**
- * Store custom oarameter configuration in LittleFS
+ * Stage the changed configuration, saveConfigStep(..) appends it to the journal over the next frames
  */
-bool saveConfig(const char* filename, Properties& properties) {
+bool beginSaveConfig(Properties& properties) {
     bool ret = false;
 
-    if (LittleFS.begin()) {
-        LittleFS.remove(filename);
-        File configFile = LittleFS.open(filename, "w");
-
-        if (configFile) {
-            Serial.print(F("Saving config : "));
-            Serial.println(filename);
-            serializeProperties<32>(configFile, properties);
-            // serializeProperties<32>(Serial, properties);
-            ret = true;
-        } else {
-            Serial.print(F("Failed to write file"));
-            Serial.println(filename);
-        }
+    if (littleFSStorage.mounted()) {
+        Properties persistent;
+        persistentConfig(persistent, properties);
+        ret = configJournal.beginSave(persistent);
+    }
 
-        configFile.close();
-        //    LittleFS.end();
+    if (!ret) {
+        Serial.println(F("Failed to save config"));
     }
 
     return ret;
 }
 
+/**
+ * Start writing controllerConfig when configWriteScheduler decides it´s time, or when p_force is set and changes are pending
+ */
+void persistConfig(uint32_t currentMillis, bool p_force) {
+    if (configJournal.isSaving() ||
+        !(configWriteScheduler.isDue(currentMillis) || (p_force && configWriteScheduler.isPending()))) {
+        return;
+    }
+
+    configWriteScheduler.started();
+    configSaveLongestStep = 0;
+
+    if (!beginSaveConfig(controllerConfig)) {
+        configWriteScheduler.written(currentMillis, 0, false);
+    }
+}
+
+/**
+ * Write the next chunk of the configuration within CONFIG_SAVE_STEP_BUDGET, when p_force is set write all of it
+ */
+void saveConfigStep(uint32_t currentMillis, bool p_force) {
+    if (!configJournal.isSaving()) {
+        return;
+    }
+
+    uint32_t start = micros();
+    bool done = true;
+
+    if (p_force) {
+        configJournal.finishSave();
+    } else {
+        done = configJournal.saveStep(CONFIG_SAVE_STEP_BUDGET, micros);
+    }
+
+    configSaveLongestStep = std::max(configSaveLongestStep, micros() - start);
+
+    if (done) {
+        configWriteScheduler.written(currentMillis, configSaveLongestStep, configJournal.lastSaveOk());
+
+        Serial.printf("Config saved %s longest step %uus worst %uus writes %u avoided %u written %u changed %u compactions %u\n",
+                      configJournal.lastSaveOk() ? "ok" : "failed",
+                      (unsigned)configSaveLongestStep, (unsigned)configWriteScheduler.worstLatency(),
+                      (unsigned)configWriteScheduler.writesMade(), (unsigned)configWriteScheduler.writesAvoided(),
+                      (unsigned)configJournal.bytesWritten(), (unsigned)configJournal.bytesChanged(),
+                      (unsigned)configJournal.compactions());
+        Serial.printf("Storage append %u max %uus flush %u max %uus write %u max %uus metadata %u max %uus\n",
+                      (unsigned)configStorage.stats(TimedStorage::APPEND).count, (unsigned)configStorage.stats(TimedStorage::APPEND).max,
+                      (unsigned)configStorage.stats(TimedStorage::FLUSH).count, (unsigned)configStorage.stats(TimedStorage::FLUSH).max,
+                      (unsigned)configStorage.stats(TimedStorage::WRITE).count, (unsigned)configStorage.stats(TimedStorage::WRITE).max,
+                      (unsigned)configStorage.stats(TimedStorage::METADATA).count, (unsigned)configStorage.stats(TimedStorage::METADATA).max);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////
 //  MQTT
 ///////////////////////////////////////////////////////////////////////////
@@ -153,15 +288,14 @@ bool saveConfig(const char* filename, Properties& properties) {
 * ri = When bool is pressed
 *
 */
-void publishRelativeToBaseMQTT(const char* topic, const char* payload);
+void publishToMQTT(const char* topic, const char* payload, bool retain = true);
 void publishStatusToMqtt() {
 
     auto format = "en=%i ri=%i";
     char buffer[16]; // 10 characters per item times extra items to be sure
     bool button = digitalKnob.current();
-    boolean ringerOn = controllerConfig.get("ringerOn");
     sprintf(buffer, format,
-            ringerOn,
+            controllerSettings.ringerOn,
             button
            );
 
@@ -169,7 +303,7 @@ void publishStatusToMqtt() {
     uint16_t thisCrc = CRCEEProm::crc16((uint8_t*)buffer, std::strlen(buffer));
 
     if (thisCrc != lastMeasurementCRC) {
-        publishRelativeToBaseMQTT("status", buffer);
+        publishToMQTT(controllerSettings.mqttStatusTopic, buffer);
     }
 
     lastMeasurementCRC = thisCrc;
@@ -178,43 +312,123 @@ void publishStatusToMqtt() {
 /**
  * Publish a message to mqtt
  */
-void publishToMQTT(const char* topic, const char* payload) {
-    if (!mqttClient.publish(topic, payload, true)) {
+void publishToMQTT(const char* topic, const char* payload, bool retain) {
+    if (!mqttClient.publish(topic, payload, retain)) {
         Serial.println(F("Failed to publish"));
     }
 }
 
-void publishRelativeToBaseMQTT(const char* topic, const char* payload) {
+void publishRelativeToBaseMQTT(const char* topic, const char* payload, bool retain = true) {
     char buffer[65];
-    const char* mqttBaseTopic = controllerConfig.get("mqttBaseTopic");
-    strncpy(buffer, mqttBaseTopic, sizeof(buffer));
+    strncpy(buffer, controllerSettings.mqttBaseTopic, sizeof(buffer));
     strncat(buffer, "/", sizeof(buffer));
     strncat(buffer, topic, sizeof(buffer));
-    publishToMQTT(buffer, payload);
+    publishToMQTT(buffer, payload, retain);
+}
+
+#ifdef PROFILER
+/**
+ * Publish count/min/avg/p99/max in us of each profiled section to <mqttBaseTopic>/profile/<section>
+ */
+void publishProfile() {
+    char topic[32];
+    char payload[64];
+
+    for (uint8_t i = 0; i < profiler.size(); i++) {
+        snprintf(topic, sizeof(topic), "profile/%s", profiler.name(i));
+        profiler.format(i, payload, sizeof(payload));
+        publishRelativeToBaseMQTT(topic, payload);
+    }
 }
 
+/**
+ * Cycles of the pin work of a frame: button read, DigitalKnob update, ringer tick and the led and relay writes
+ * Measured once with digitalRead/digitalWrite in section pins.arduino and once with FastPin in section pins.fast.
+ * The knob and ringer are copies so the real button and bell are not affected, the writes repeat the current state
+ * of the led and relay. Interrupts are off during each iteration so only the pin work is counted.
+ */
+void benchmarkFramePins() {
+    const uint16_t ITERATIONS = 1000;
+    DigitalKnob arduinoKnob(BUTTON_PIN, INVERT_INPUT, 110, EFFECT_PERIOD_CALLBACK, false);
+    DigitalKnob fastKnob(BUTTON_PIN, false, 110, EFFECT_PERIOD_CALLBACK, false);
+    Ringer arduinoRinger;
+    Ringer fastRinger;
+
+    for (uint16_t i = 0; i < ITERATIONS; i++) {
+        noInterrupts();
+        {
+            PROFILE_SCOPE(profiler, "pins.arduino");
+            arduinoKnob.handle();
+            arduinoRinger.tick();
+            digitalWrite(LED_PIN, digitalKnob.current());
+            digitalWrite(RINGER_PIN, ringer.relay() ^ INVERT_OUTPUT);
+        }
+        interrupts();
+    }
+
+    for (uint16_t i = 0; i < ITERATIONS; i++) {
+        noInterrupts();
+        {
+            PROFILE_SCOPE(profiler, "pins.fast");
+            fastKnob.handle(ButtonPin::read());
+            fastRinger.tick();
+            LedPin::write(digitalKnob.current());
+            RingerPin::write(ringer.relay());
+        }
+        interrupts();
+    }
+}
+#endif
+
 /////////////////////////////////////////////////////////////////////////////////////
 
+void startButtonTrace(uint32_t p_duration);
 /**
  * Handle incomming MQTT requests
  */
 void handleCmd(const char* topic, const char* p_payload) {
-    const char* mqttClientID = controllerConfig.get("mqttClientID");
-    uint8_t mqttSubscriberTopicStrLength = std::strlen(mqttClientID);
+    uint8_t mqttSubscriberTopicStrLength = std::strlen(controllerSettings.mqttClientID);
 
     auto topicPos = topic + mqttSubscriberTopicStrLength;
     // Serial.print(F("Handle command : "));
     // Serial.println(topicPos);
 
-    char payloadBuffer[16];
-    strncpy(payloadBuffer, p_payload, sizeof(payloadBuffer));
+    // Same size as the receive buffer so a gesture code is never cut, OptParser needs it terminated
+    char payloadBuffer[64];
+    strncpy(payloadBuffer, p_payload, sizeof(payloadBuffer) - 1);
+    payloadBuffer[sizeof(payloadBuffer) - 1] = 0;
     if (std::strstr(topicPos, "/config") != nullptr) {
         bool on;
         OptParser::get(payloadBuffer, [&on](OptValue values) {
 
             if (std::strcmp(values.key(), "en") == 0) {
-                controllerConfig.put("ringerOn", PV((int)values != 0));
-                controllerConfigModified = true;
+                putConfigValue(controllerConfig, KEY_RINGER_ON, PV((int)values != 0));
+                controllerConfigChanged();
+            }
+
+            if (std::strcmp(values.key(), "cu") == 0) {
+                putConfigValue(controllerConfig, KEY_FRAME_CATCH_UP, PV((int)values));
+                controllerConfigChanged();
+            }
+
+            if (std::strcmp(values.key(), "dmin") == 0) {
+                putConfigValue(controllerConfig, KEY_DEBOUNCE_MIN_ALPHA, PV((int)values));
+                controllerConfigChanged();
+            }
+
+            if (std::strcmp(values.key(), "dmax") == 0) {
+                putConfigValue(controllerConfig, KEY_DEBOUNCE_MAX_ALPHA, PV((int)values));
+                controllerConfigChanged();
+            }
+
+            if (std::strcmp(values.key(), "tmin") == 0) {
+                putConfigValue(controllerConfig, KEY_DEBOUNCE_MIN_TIME, PV((int)values));
+                controllerConfigChanged();
+            }
+
+            if (std::strcmp(values.key(), "tmax") == 0) {
+                putConfigValue(controllerConfig, KEY_DEBOUNCE_MAX_TIME, PV((int)values));
+                controllerConfigChanged();
             }
 
         });
@@ -222,6 +436,48 @@ void handleCmd(const char* topic, const char* p_payload) {
         Serial.println("Config");
     }
 
+    if (strstr(topicPos, "/gesture") != nullptr) {
+        OptParser::get(payloadBuffer, [](OptValue v) {
+            char name[GESTURE_ENGINE_NAME_LENGTH + sizeof(GESTURE_PROPERTY_PREFIX)];
+            snprintf(name, sizeof(name), GESTURE_PROPERTY_PREFIX "%s", v.key());
+
+            if (std::strlen(v.asChar()) == 0) {
+                controllerConfig.erase(name);
+            } else if (canAddGesture(controllerConfig, name + strlen(GESTURE_PROPERTY_PREFIX), v.asChar())) {
+                controllerConfig.put(name, PV(v.asChar()));
+            } else {
+                Serial.printf("Gesture %s rejected\n", v.key());
+                publishRelativeToBaseMQTT("gesture/rejected", v.key(), false);
+                return;
+            }
+
+            controllerConfigChanged();
+        });
+    }
+
+#ifdef PROFILER
+
+    if (strstr(topicPos, "/profile") != nullptr) {
+        OptParser::get(payloadBuffer, [](OptValue v) {
+            if (strcmp(v.key(), "1") == 0) {
+                publishProfile();
+            } else if (strcmp(v.key(), "b") == 0) {
+                benchmarkFramePins();
+                publishProfile();
+            } else if (strcmp(v.key(), "r") == 0) {
+                profiler.reset();
+            }
+        });
+    }
+
+#endif
+
+    if (strstr(topicPos, "/trace") != nullptr) {
+        OptParser::get(payloadBuffer, [](OptValue v) {
+            startButtonTrace(std::min((uint32_t)atol(v.key()), BUTTON_TRACE_MAX_TIME));
+        });
+    }
+
     if (strstr(topicPos, "/reset") != nullptr) {
         OptParser::get(payloadBuffer, [](OptValue v) {
             if (strcmp(v.key(), "1") == 0) {
@@ -257,16 +513,33 @@ void setupMQTT() {
 
 
 void serverOnlineCallback() {
+#ifdef PROFILER
+    // Plain text snapshot of the profiler, one section per line
+    wm.server->on("/profile", []() {
+        char body[PROFILER_SECTIONS * 64];
+        size_t pos = 0;
+
+        for (uint8_t i = 0; i < profiler.size() && pos < sizeof(body); i++) {
+            pos += snprintf(body + pos, sizeof(body) - pos, "%s ", profiler.name(i));
+
+            if (pos < sizeof(body)) {
+                pos += profiler.format(i, body + pos, sizeof(body) - pos);
+            }
+
+            if (pos < sizeof(body)) {
+                pos += snprintf(body + pos, sizeof(body) - pos, "\n");
+            }
+        }
+
+        wm.server->send(200, "text/plain", body);
+    });
+#endif
 }
 
 /**
  * Setup statemachine that will handle reconnection to mqtt after WIFI drops
  */
 void setupWIFIReconnectManager() {
-    static char mqttLastWillTopic[64];
-    const char* mqttClientID = controllerConfig.get("mqttClientID");
-    snprintf(mqttLastWillTopic, sizeof(mqttLastWillTopic), "%s/%s", mqttClientID, MQTT_LASTWILL_TOPIC);
-
     // Statemachine to handle (re)connection to MQTT
     State* BOOTSEQUENCESTART = new State;
     State* DELAYEDMQTTCONNECTION = new StateTimed {1500};
@@ -280,9 +553,7 @@ void setupWIFIReconnectManager() {
         return TESTMQTTCONNECTION;
     });
     DELAYEDMQTTCONNECTION->setRunnable([DELAYEDMQTTCONNECTION, TESTMQTTCONNECTION]() {
-        hasMqttConfigured =
-            controllerConfig.contains("mqttServer") &&
-            std::strlen((const char*)controllerConfig.get("mqttServer")) > 0;
+        hasMqttConfigured = controllerSettings.hasMqttServer;
 
         if (!hasMqttConfigured) {
             return DELAYEDMQTTCONNECTION;
@@ -311,15 +582,15 @@ void setupWIFIReconnectManager() {
     });
     CONNECTMQTT->setRunnable([PUBLISHONLINE, DELAYEDMQTTCONNECTION]() {
         mqttClient.setServer(
-            controllerConfig.get("mqttServer"),
-            (int16_t)controllerConfig.get("mqttPort")
+            controllerSettings.mqttServer,
+            controllerSettings.mqttPort
         );
 
         if (mqttClient.connect(
-                controllerConfig.get("mqttClientID"),
-                controllerConfig.get("mqttUsername"),
-                controllerConfig.get("mqttPassword"),
-                mqttLastWillTopic,
+                controllerSettings.mqttClientID,
+                controllerSettings.mqttUsername,
+                controllerSettings.mqttPassword,
+                controllerSettings.mqttLastWillTopic,
                 0,
                 1,
                 MQTT_LASTWILL_OFFLINE)
@@ -331,16 +602,12 @@ void setupWIFIReconnectManager() {
     });
     PUBLISHONLINE->setRunnable([SUBSCRIBECOMMANDTOPIC]() {
         publishToMQTT(
-            mqttLastWillTopic,
+            controllerSettings.mqttLastWillTopic,
             MQTT_LASTWILL_ONLINE);
         return SUBSCRIBECOMMANDTOPIC;
     });
     SUBSCRIBECOMMANDTOPIC->setRunnable([WAITFORCOMMANDCAPTURE, DELAYEDMQTTCONNECTION]() {
-        char mqttSubscriberTopic[32];
-        const char* mqttClientID = controllerConfig.get("mqttClientID");
-        snprintf(mqttSubscriberTopic, sizeof(mqttSubscriberTopic), "%s/+", mqttClientID);
-
-        if (mqttClient.subscribe(mqttSubscriberTopic, 0)) {
+        if (mqttClient.subscribe(controllerSettings.mqttSubscriberTopic, 0)) {
             return WAITFORCOMMANDCAPTURE;
         }
 
@@ -361,13 +628,18 @@ void saveParamCallback() {
     Serial.println("[CALLBACK] saveParamCallback fired");
 
     if (std::strlen(wm_mqtt_server.getValue()) > 0) {
-        controllerConfig.put("mqttServer", PV(wm_mqtt_server.getValue()));
-        controllerConfig.put("mqttPort", PV(std::atoi(wm_mqtt_port.getValue())));
-        controllerConfig.put("mqttUsername", PV(wm_mqtt_user.getValue()));
-        controllerConfig.put("mqttPassword", PV(wm_mqtt_password.getValue()));
-        controllerConfigModified = true;
-        // Redirect from MQTT so on the next reconnect we pickup new values
-        mqttClient.disconnect();
+        // Invalid values are not stored, the previous value stays
+        bool valid = putConfigValue(controllerConfig, KEY_MQTT_SERVER, PV(wm_mqtt_server.getValue())) == ConfigError::NONE;
+        valid &= putConfigValue(controllerConfig, KEY_MQTT_PORT, PV(std::atoi(wm_mqtt_port.getValue()))) == ConfigError::NONE;
+        valid &= putConfigValue(controllerConfig, KEY_MQTT_USERNAME, PV(wm_mqtt_user.getValue())) == ConfigError::NONE;
+        valid &= putConfigValue(controllerConfig, KEY_MQTT_PASSWORD, PV(wm_mqtt_password.getValue())) == ConfigError::NONE;
+
+        if (!valid) {
+            Serial.println(F("Invalid MQTT parameters"));
+        }
+
+        // CONFIG_RECONNECT disconnects from MQTT so on the next reconnect we pickup new values
+        controllerConfigChanged();
         // Send redirect back to param page
         wm.server->sendHeader(F("Location"), F("/param?"), true);
         wm.server->send(302, FPSTR(HTTP_HEAD_CT2), "");   // Empty content inhibits Content-length header so we have to close the socket ourselves.
@@ -380,11 +652,11 @@ void saveParamCallback() {
  */
 void setupWifiManager() {
     char port[6];
-    snprintf(port, sizeof(port), "%d", (int16_t)controllerConfig.get("mqttPort"));
+    snprintf(port, sizeof(port), "%d", (int16_t)controllerConfig.get(KEY_MQTT_PORT));
     wm_mqtt_port.setValue(port, MQTT_PORT_LENGTH);
-    wm_mqtt_password.setValue(controllerConfig.get("mqttPassword"), MQTT_PASSWORD_LENGTH);
-    wm_mqtt_user.setValue(controllerConfig.get("mqttUsername"), MQTT_USERNAME_LENGTH);
-    wm_mqtt_server.setValue(controllerConfig.get("mqttServer"), MQTT_SERVER_LENGTH);
+    wm_mqtt_password.setValue(controllerConfig.get(KEY_MQTT_PASSWORD), MQTT_PASSWORD_LENGTH);
+    wm_mqtt_user.setValue(controllerConfig.get(KEY_MQTT_USERNAME), MQTT_USERNAME_LENGTH);
+    wm_mqtt_server.setValue(controllerConfig.get(KEY_MQTT_SERVER), MQTT_SERVER_LENGTH);
 
     // Set extra setup page
     wm.setWebServerCallback(serverOnlineCallback);
@@ -402,15 +674,15 @@ void setupWifiManager() {
     wm.setConfigPortalBlocking(false); // Must be blocking or else AP stays active
     wm.setDebugOutput(false);
     wm.setSaveParamsCallback(saveParamCallback);
-    wm.setHostname(controllerConfig.get("mqttBaseTopic"));
+    wm.setHostname(controllerConfig.get(KEY_MQTT_BASE_TOPIC));
     std::vector<const char*> menu = {"wifi", "wifinoscan", "info", "param", "sep", "erase", "restart"};
     wm.setMenu(menu);
 
     wm.startWebPortal();
-    wm.autoConnect(controllerConfig.get("mqttClientID"));
+    wm.autoConnect(controllerConfig.get(KEY_MQTT_CLIENT_ID));
 #if defined(ESP8266)
     WiFi.setSleepMode(WIFI_NONE_SLEEP);
-    MDNS.begin(controllerConfig.get("mqttClientID"));
+    MDNS.begin(controllerConfig.get(KEY_MQTT_CLIENT_ID));
     MDNS.addService(0, "http", "tcp", 80);
 #endif
 }
@@ -426,99 +698,370 @@ void setupDefaults() {
     char mqttClientID[16];
     snprintf(mqttClientID, sizeof(mqttClientID), "DOORBELL%s", chipHexBuffer);
 
-    char mqttBaseTopic[16] = "DOORBELL";
+    applyConfigDefaults(controllerConfig, mqttClientID);
+}
+
+void setupConfigListeners() {
+    controllerConfigListeners.onGroup(CONFIG_PUBLISH, publishStatusToMqtt);
+    controllerConfigListeners.onGroup(CONFIG_RECONNECT, []() {
+        mqttClient.disconnect();
+    });
+}
+
+/**
+ * Publish runs, average and max execution time in us of each maintenance task
+ */
+void publishTaskStats() {
+    if (!mqttClient.connected()) {
+        return;
+    }
+
+    char buffer[128];
+    size_t pos = 0;
+
+    for (uint8_t i = 0; i < taskScheduler.size() && pos < sizeof(buffer); i++) {
+        const TaskScheduler::Stats& stats = taskScheduler.stats(i);
+        pos += snprintf(buffer + pos, sizeof(buffer) - pos, "%s%s=%u/%u/%u",
+                        i == 0 ? "" : " ", taskScheduler.name(i), stats.runs,
+                        stats.runs == 0 ? 0 : stats.total / stats.runs, stats.max);
+    }
+
+    publishRelativeToBaseMQTT("tasks", buffer);
+    taskScheduler.resetStats();
+}
+
+/**
+ * Publish frame count, overruns, skipped frames, the longest stall in us with its cause and the jitter histogram
+ */
+void publishFrameStats() {
+    if (!mqttClient.connected()) {
+        return;
+    }
+
+    char buffer[192];
+    int pos = snprintf(buffer, sizeof(buffer), "frames=%u overruns=%u skipped=%u stall=%u/%s jitter=",
+                       frameClock.frames(), frameClock.overruns(), frameClock.skipped(),
+                       frameClock.longestStall(), frameClock.stallCause());
+
+    for (uint8_t i = 0; i < FRAME_CLOCK_BUCKETS && pos < (int)sizeof(buffer); i++) {
+        pos += snprintf(buffer + pos, sizeof(buffer) - pos, i == 0 ? "%u" : ",%u", frameClock.jitter(i));
+    }
+
+    publishRelativeToBaseMQTT("frames", buffer);
+    frameClock.resetStats();
+}
+
+/**
+ * Publish the number of rings, rings stopped by maxRingTime, press to ring latency last/max in us,
+ * duration of the last ring in ms and commands that did not fit in the mailbox
+ */
+void publishRingerStats() {
+    if (!mqttClient.connected()) {
+        return;
+    }
+
+    char buffer[96];
+    snprintf(buffer, sizeof(buffer), "rings=%u truncated=%u latency=%u/%u duration=%u overflows=%u",
+             ringer.rings(), ringer.truncated(), ringer.lastLatency(), ringer.maxLatency(),
+             ringer.lastDuration(), ringer.mailboxOverflows());
+    publishRelativeToBaseMQTT("ringer", buffer);
+}
+
+/**
+ * Publish the debounce time or the alpha of the button filter, whichever is used, and the noise it measured
+ */
+void publishDebounceStats() {
+    if (!mqttClient.connected()) {
+        return;
+    }
+
+    char buffer[80];
 
-    char mqttLastWillTopic[64];
-    snprintf(mqttLastWillTopic, sizeof(mqttLastWillTopic), "%s/%s", mqttBaseTopic, MQTT_LASTWILL_TOPIC);
+    if (BUTTON_EDGE_CAPTURE) {
+        snprintf(buffer, sizeof(buffer), "time=%u glitches=%u short=%u transitions=%u",
+                 buttonCapture.debounce(), buttonCapture.glitches(), buttonCapture.shortPresses(),
+                 digitalKnob.transitions());
+    } else {
+        snprintf(buffer, sizeof(buffer), "alpha=%i glitches=%u short=%u transitions=%u",
+                 digitalKnob.alpha(), digitalKnob.glitches(), digitalKnob.shortPresses(), digitalKnob.transitions());
+    }
+
+    publishRelativeToBaseMQTT("debounce", buffer);
+}
+
+/**
+ * Publish captured edges, glitches, lost edges, the latency in us of the last press and lost press events
+ */
+void publishButtonStats() {
+    if (!mqttClient.connected() || !BUTTON_EDGE_CAPTURE) {
+        return;
+    }
+
+    char buffer[80];
+    snprintf(buffer, sizeof(buffer), "edges=%u glitches=%u overflows=%u latency=%u lost=%u",
+             buttonCapture.edges(), buttonCapture.glitches(), buttonCapture.overflows(), buttonPressLatency,
+             digitalKnob.lostEvents() + buttonCapture.changeOverflows());
+    publishRelativeToBaseMQTT("button", buffer);
+}
+
+/**
+ * Publish the press events of the button in order, the timestamps are ms of millis() on the doorbell
+ */
+void publishPressEvents() {
+    if (!mqttClient.connected()) {
+        return;
+    }
 
-    controllerConfigModified |= controllerConfig.putNotContains("mqttClientID", PV(mqttClientID));
-    controllerConfigModified |= controllerConfig.putNotContains("mqttBaseTopic", PV(mqttBaseTopic));
-    controllerConfigModified |= controllerConfig.putNotContains("mqttLastWillTopic", PV(mqttLastWillTopic));
+    static const char* const types[] = {"up", "down", "single", "double", "long"};
+    PressEvent events[DIGITAL_INPUT_EVENTS];
+    uint8_t count = digitalKnob.events(events, DIGITAL_INPUT_EVENTS);
 
-    controllerConfigModified |= controllerConfig.putNotContains("mqttServer", PV(""));
-    controllerConfigModified |= controllerConfig.putNotContains("mqttUsername", PV(""));
-    controllerConfigModified |= controllerConfig.putNotContains("mqttPassword", PV(""));
-    controllerConfigModified |= controllerConfig.putNotContains("mqttPort", PV(1883));
-    controllerConfigModified |= controllerConfig.putNotContains("mqttBaseTopic", PV(mqttBaseTopic));
-    controllerConfigModified |= controllerConfig.putNotContains("ringerOn", PV(true));
-    controllerConfigModified |= controllerConfig.putNotContains("maxRingTime", PV(5000));
+    for (uint8_t i = 0; i < count; i++) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "seq=%u type=%s start=%u duration=%u",
+                 events[i].m_sequence, types[events[i].m_type], events[i].m_start, events[i].m_duration);
+        // Events, they must not be retained
+        publishRelativeToBaseMQTT("press", buffer, false);
+    }
+}
+
+/**
+ * Record the raw level of the button for p_duration ms
+ */
+void startButtonTrace(uint32_t p_duration) {
+    if (p_duration == 0) {
+        return;
+    }
+
+    buttonTracePublishing = false;
+    buttonTrace.start(ButtonPin::read(), micros());
+    buttonTraceEnd = std::max(millis() + p_duration, (uint32_t)1);
+}
+
+/**
+ * Stop the trace when it is full or its time is up, then publish it one part per call on Serial and MQTT
+ * The first part is "res=<us> runs=<n> full=<0|1>", the parts after that are the runs of InputTrace::format(..)
+ */
+void publishButtonTrace() {
+    char buffer[128];
+
+    if (buttonTraceEnd != 0) {
+        if (buttonTrace.recording() && (int32_t)(millis() - buttonTraceEnd) < 0) {
+            return;
+        }
+
+        noInterrupts();
+        buttonTrace.stop(micros());
+        interrupts();
+        buttonTraceEnd = 0;
+        buttonTraceEntry = 0;
+        buttonTracePublishing = true;
+        snprintf(buffer, sizeof(buffer), "res=%u runs=%u full=%i",
+                 buttonTrace.resolution(), buttonTrace.size(), buttonTrace.full());
+    } else if (!buttonTracePublishing) {
+        return;
+    } else if (buttonTrace.format(buffer, sizeof(buffer), buttonTraceEntry) == 0) {
+        buttonTracePublishing = false;
+        return;
+    }
+
+    Serial.println(buffer);
+
+    if (mqttClient.connected()) {
+        publishRelativeToBaseMQTT("trace", buffer, false);
+    }
+}
+
+void setupTasks() {
+    // Inbound MQTT is handled every frame while data is waiting
+    taskScheduler.add("mqtt", 200, 5, 40, 3000, []() {
+        PROFILE_SCOPE(profiler, "mqtt");
+        mqttClient.loop();
+    }, []() {
+        return wifiClient.available() > 0;
+    });
+    taskScheduler.add("boot", 200, 4, 200, 1000, []() {
+        PROFILE_SCOPE(profiler, "boot");
+        bootSequence->handle();
+    });
+    taskScheduler.add("config", 200, 3, 200, 1000, []() {
+        PROFILE_SCOPE(profiler, "config");
+        const uint32_t currentMillis = millis();
+        uint8_t groups = controllerConfigListeners.dispatch(controllerConfig);
+
+        if (groups & CONFIG_PERSIST) {
+            configWriteScheduler.changed(currentMillis, groups & CONFIG_CRITICAL);
+        }
+
+        persistConfig(currentMillis, false);
+    });
+    // Press events are queued by the button, so they can be drained in batches
+    taskScheduler.add("press", 200, 3, 400, 2000, []() {
+        PROFILE_SCOPE(profiler, "press");
+        publishPressEvents();
+    });
+    taskScheduler.add("trace", 200, 1, 1000, 2000, []() {
+        publishButtonTrace();
+    });
+    taskScheduler.add("wm", 200, 2, 400, 3000, []() {
+        PROFILE_SCOPE(profiler, "wm");
+        wm.process();
+    });
+    taskScheduler.add("restart", 100, 1, 1000, 500, []() {
+        const uint32_t currentMillis = millis();
+
+        if (shouldRestart != 0 && (currentMillis - shouldRestart >= 5000)) {
+            shouldRestart = 0;
+            persistConfig(currentMillis, true);
+            saveConfigStep(currentMillis, true);
+            ESP.restart();
+        }
+    });
+    taskScheduler.add("stats", TASK_STATS_PERIOD, 0, 5000, 2000, []() {
+        publishTaskStats();
+        publishFrameStats();
+        publishRingerStats();
+        publishButtonStats();
+        publishDebounceStats();
+    });
+}
+
+void IRAM_ATTR ringerTimerISR() {
+    if (BUTTON_EDGE_CAPTURE) {
+        uint32_t now = micros();
+        bool pressed = buttonCapture.current();
+
+        if (buttonCapture.update(now) != pressed) {
+            ringer.button(!pressed, now - (pressed ? buttonCapture.lastRelease() : buttonCapture.lastPress()));
+        }
+    }
+
+    RingerPin::write(ringer.tick());
+
+    if (buttonTrace.recording()) {
+        buttonTrace.record(ButtonPin::read(), micros());
+    }
+}
+
+/**
+ * Tick the ringer every ms from timer1, analogWrite and tone also use timer1 so they cannot be used
+ */
+void setupRinger() {
+    timer1_attachInterrupt(ringerTimerISR);
+    timer1_enable(TIM_DIV16, TIM_EDGE, TIM_LOOP);
+    timer1_write(RINGER_TIMER_TICKS);
+}
+
+void IRAM_ATTR buttonISR() {
+    buttonCapture.capture(ButtonPin::read(), micros());
 }
 
 void setup() {
     pinMode(RINGER_PIN, OUTPUT);
-    digitalWrite(RINGER_PIN, INVERT_OUTPUT);
+    RingerPin::write(false);
     pinMode(LED_PIN, OUTPUT);
-    digitalWrite(LED_PIN, 0);
+    LedPin::write(false);
 
     // Enable serial port
     Serial.begin(115200);
     delay(050);
     // load configurations
     loadConfig(CONFIG_FILENAME, controllerConfig);
+    // Only defaults that were missing need to be persisted
+    controllerConfig.clearDirty();
     setupDefaults();
+    controllerConfigChanged();
+    setupRinger();
+    setupConfigListeners();
+    setupTasks();
 
     setupMQTT();
     setupWifiManager();
     setupWIFIReconnectManager();
     digitalKnob.init();
 
+    if (BUTTON_EDGE_CAPTURE) {
+        attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), buttonISR, CHANGE);
+    }
+
     Serial.println(F("End Setup"));
-    effectPeriodStartMillis = millis();
+    frameClock.start(micros());
 
 }
 
-#define NUMBER_OF_SLOTS 10
 void loop() {
-    const uint32_t currentMillis = millis();
-
-    if (currentMillis - effectPeriodStartMillis >= EFFECT_PERIOD_CALLBACK) {
-        effectPeriodStartMillis += EFFECT_PERIOD_CALLBACK;
-        counter50TimesSec++;
+    if (frameClock.tick(micros())) {
+        const uint32_t currentMillis = millis();
 
         // DigitalKnob (the button) must be handled at 50 times/sec to correct handle presses and double presses
-        digitalKnob.handle();
+        {
+            PROFILE_SCOPE(profiler, "knob");
+
+            if (BUTTON_EDGE_CAPTURE) {
+                // Every change the timer interrupt accepted since the last frame, also a press that already ended
+                EdgeCapture::Edge change;
+
+                while (buttonCapture.nextChange(change)) {
+                    // Age of the edge in us, so the µs capture time maps onto millis() without a wrap mismatch
+                    uint32_t edgeAge = micros() - change.m_time;
+                    digitalKnob.handleChange(change.m_level, millis() - edgeAge / 1000);
+                }
+
+                digitalKnob.handleTick();
+
+                if (digitalKnob.isEdgeUp()) {
+                    buttonPressLatency = micros() - buttonCapture.lastPress();
+                }
+            } else {
+                digitalKnob.handle(ButtonPin::read());
+            }
 
-        //////////////////////////
-        // Record time when we started the bell
-        if (digitalKnob.isEdgeUp()) {
-            bellStartTime = currentMillis;
+            // Gestures are events, they must not be retained
+            // A press that started and ended within this frame is a press of one frame
+            int8_t gesture = gestureEngine.handle(digitalKnob.current() || digitalKnob.isEdgeUp());
+
+            if (gesture >= 0) {
+                publishRelativeToBaseMQTT("gesture", gestureEngine.name(gesture), false);
+            }
         }
 
-        // Always show the digital led
-        digitalWrite(LED_PIN, digitalKnob.current());
+        //////////////////////////
+        {
+            PROFILE_SCOPE(profiler, "ringer");
 
-        // Ringer the bell when we have it enabled and when it´s within the allowed timeframe
-        if (controllerConfig.get("ringerOn") &&
-            (currentMillis - bellStartTime < (uint32_t)controllerConfig.get("maxRingTime").asLong())) {
-            digitalWrite(RINGER_PIN, digitalKnob.current() ^ INVERT_OUTPUT);
-        } else {
-            digitalWrite(RINGER_PIN, INVERT_OUTPUT);
+            // The ringer decides if and how long the bell rings, with edge capture it gets the button in the interrupt
+            if (ringerConfigPending) {
+                configureRinger();
+            }
+
+            if (!BUTTON_EDGE_CAPTURE) {
+                if (digitalKnob.isEdgeUp()) {
+                    ringer.post(Ringer::RINGER_PRESS);
+                } else if (digitalKnob.isEdgeDown()) {
+                    ringer.post(Ringer::RINGER_RELEASE);
+                }
+            }
+
+            // Always show the digital led
+            LedPin::write(digitalKnob.current());
         }
 
         if (digitalKnob.isEdgeUp() || digitalKnob.isEdgeDown()) {
             publishStatusToMqtt();
         }
 
+        // Spread writing the configuration over frames so the ringer and button keep their timing
+        {
+            PROFILE_SCOPE(profiler, "save");
+            uint32_t saveStart = micros();
+            saveConfigStep(currentMillis, false);
+            frameClock.blame("save", micros() - saveStart);
+        }
+
         //////////////////////////
 
         // Maintenance stuff
-        uint8_t slot50 = 0;
-
-        if (counter50TimesSec % NUMBER_OF_SLOTS == slot50++) {
-            bootSequence->handle();
-        } else if (counter50TimesSec % NUMBER_OF_SLOTS == slot50++) {
-            mqttClient.loop();
-        } else if (counter50TimesSec % NUMBER_OF_SLOTS == slot50++) {
-            if (controllerConfigModified) {
-                controllerConfigModified = false;
-                publishStatusToMqtt();
-                saveConfig(CONFIG_FILENAME, controllerConfig);
-            }
-        } else if (counter50TimesSec % NUMBER_OF_SLOTS == slot50++) {
-            wm.process();
-        } else if (shouldRestart != 0 && (currentMillis - shouldRestart >= 5000)) {
-            shouldRestart = 0;
-            ESP.restart();
-        }
+        taskScheduler.run(currentMillis);
+        frameClock.blame(taskScheduler.longestTask(), taskScheduler.longestTaskTime());
     }
 }